@@ -42,6 +42,22 @@ static void ext_err( const char* func, const char* file, int line, const char* f
 
 #define ERR( ... ) ext_err( __func__, __FILE__, __LINE__, __VA_ARGS__ )
 
+/**********************************************************************************************************************/
+/// Shared alloc function (process specific; s. btree_set_shared_alloc)
+
+static void* ( *btree_shared_alloc_g )( void* arg, void*, size_t size ) = NULL;
+
+void btree_set_shared_alloc( void* (*alloc)( void* arg, void*, size_t size ) )
+{
+    btree_shared_alloc_g = alloc;
+}
+
+static void* btree_shared_alloc( void* arg, void* ptr, size_t size )
+{
+    if( !btree_shared_alloc_g ) ERR( "No shared alloc function set (s. btree_set_shared_alloc)." );
+    return btree_shared_alloc_g( arg, ptr, size );
+}
+
 /**********************************************************************************************************************/
 /**********************************************************************************************************************/
 /// btree_ps
@@ -80,9 +96,11 @@ typedef struct btree_node_ps_s
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-/// children of leaf-nodes point to btree_node_ps_s_null
-btree_node_ps_s btree_node_ps_s_null_g = { { 0, 0 }, { 0, 0 }, NULL, NULL, NULL, NULL };
-#define BNUL_PS ( &btree_node_ps_s_null_g )
+/** Children of leaf-nodes carry this marker. It is not a valid node address and never dereferenced
+ *  (writing to it faults). Unlike the address of a static object, it is identical in all processes,
+ *  so that trees in shared or persistent memory remain valid in any process.
+ */
+#define BNUL_PS ( ( btree_node_ps_s* )( uintptr_t )1 )
 
 // ---------------------------------------------------------------------------------------------------------------------
 
@@ -211,15 +229,6 @@ int  btree_node_ps_s_is_empty( btree_node_ps_s* o )          { return o->child1
 
 void btree_node_ps_s_check_consistency( btree_node_ps_s* o )
 {
-    if( btree_node_ps_s_null_g.kv1.key != 0    ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.kv1.val != 0    ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.kv2.key != 0    ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.kv2.val != 0    ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.parent  != NULL ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.child0  != NULL ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.child1  != NULL ) ERR( "btree_node_ps_s_null was modified" );
-    if( btree_node_ps_s_null_g.child2  != NULL ) ERR( "btree_node_ps_s_null was modified" );
-
     if( !o ) return;
     if( btree_node_ps_s_is_empty( o ) ) ERR( "empty node" );
     if( o->child0 == NULL )       ERR( "deleted leaf" );
@@ -260,11 +269,48 @@ struct btree_ps_s
     btree_node_ps_s* chain_ins; // pointer for new insertions
     btree_node_ps_s* del_chain; // chain of deleted elements (preferably used by new insertions)
     void* (*alloc)( void*, size_t size ); // alloc function
+    void* (*alloc_a)( void* arg, void*, size_t size ); // alloc function with argument (used instead of alloc when not NULL)
+    void* alloc_arg;             // argument of alloc_a or of the shared alloc function (alloc == alloc_a == NULL)
     size_t   block_size;
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+static void* btree_ps_s_alloc( btree_ps_s* o, void* ptr, size_t size )
+{
+    if( o->alloc_a ) return o->alloc_a( o->alloc_arg, ptr, size );
+    if( o->alloc   ) return o->alloc( ptr, size );
+    return btree_shared_alloc( o->alloc_arg, ptr, size );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+btree_ps_s* btree_ps_s_create_a( void* (*alloc)( void* arg, void*, size_t size ), void* arg )
+{
+    btree_ps_s* o = alloc( arg, NULL, sizeof( btree_ps_s ) );
+    o->alloc     = NULL;
+    o->alloc_a   = alloc;
+    o->alloc_arg = arg;
+    o->root      = NULL;
+    o->chain_beg = NULL;
+    o->chain_end = NULL;
+    o->chain_ins = NULL;
+    o->del_chain = NULL;
+    o->block_size = 1024;
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+btree_ps_s* btree_ps_s_create_shared( void* arg )
+{
+    btree_ps_s* o = btree_ps_s_create_a( btree_shared_alloc, arg );
+    o->alloc_a = NULL; // resolved per call (s. btree_ps_s_alloc)
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 btree_ps_s* btree_ps_s_create( void* (*alloc)( void*, size_t size ) )
 {
     btree_ps_s* o = NULL;
@@ -278,6 +324,8 @@ btree_ps_s* btree_ps_s_create( void* (*alloc)( void*, size_t size ) )
         o = alloc( NULL, sizeof( btree_ps_s ) );
         o->alloc = alloc;
     }
+    o->alloc_a   = NULL;
+    o->alloc_arg = NULL;
     o->root      = NULL;
     o->chain_beg = NULL;
     o->chain_end = NULL;
@@ -297,11 +345,11 @@ void btree_ps_s_discard( btree_ps_s* o )
     while( chain_beg )
     {
         btree_node_ps_s* new_beg = *( btree_node_ps_s** )( chain_beg + o->block_size );
-        o->alloc( chain_beg, 0 );
+        btree_ps_s_alloc( o, chain_beg, 0 );
         chain_beg = new_beg;
     }
 
-    o->alloc( o, 0 );
+    btree_ps_s_alloc( o, o, 0 );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -319,7 +367,7 @@ btree_node_ps_s* btree_ps_s_new_node( btree_ps_s* o )
     {
         if( o->chain_ins == o->chain_end )
         {
-            btree_node_ps_s* new_ptr = o->alloc( NULL, o->block_size * sizeof( btree_node_ps_s ) + sizeof( btree_node_ps_s* ) );
+            btree_node_ps_s* new_ptr = btree_ps_s_alloc( o, NULL, o->block_size * sizeof( btree_node_ps_s ) + sizeof( btree_node_ps_s* ) );
             if( !o->chain_beg )
             {
                 o->chain_beg = new_ptr;
@@ -795,9 +843,8 @@ typedef struct btree_node_vd_s
     struct btree_node_vd_s* child2;
 } btree_node_vd_s;
 
-/// children of leaf-nodes point to btree_node_vd_s_null
-btree_node_vd_s btree_node_vd_s_null_g = { { NULL }, { NULL }, NULL, NULL, NULL, NULL };
-#define BNUL_VP ( &btree_node_vd_s_null_g )
+/// children of leaf-nodes carry this marker (s. BNUL_PS)
+#define BNUL_VP ( ( btree_node_vd_s* )( uintptr_t )1 )
 
 // ---------------------------------------------------------------------------------------------------------------------
 
@@ -929,13 +976,6 @@ int  btree_node_vd_s_is_empty( btree_node_vd_s* o )          { return o->child1
 
 void btree_node_vd_s_check_consistency( btree_node_vd_s* o )
 {
-    if( btree_node_vd_s_null_g.kv1.key != 0    ) ERR( "btree_node_vd_s_null was modified" );
-    if( btree_node_vd_s_null_g.kv2.key != 0    ) ERR( "btree_node_vd_s_null was modified" );
-    if( btree_node_vd_s_null_g.parent  != NULL ) ERR( "btree_node_vd_s_null was modified" );
-    if( btree_node_vd_s_null_g.child0  != NULL ) ERR( "btree_node_vd_s_null was modified" );
-    if( btree_node_vd_s_null_g.child1  != NULL ) ERR( "btree_node_vd_s_null was modified" );
-    if( btree_node_vd_s_null_g.child2  != NULL ) ERR( "btree_node_vd_s_null was modified" );
-
     if( !o ) return;
     if( btree_node_vd_s_is_empty( o ) ) ERR( "empty node" );
     if( o->child0 == NULL )       ERR( "deleted leaf" );
@@ -976,11 +1016,48 @@ struct btree_vd_s
     btree_node_vd_s* chain_ins;   // pointer for new insertions
     btree_node_vd_s* del_chain;   // chain of deleted elements (preferably used by new insertions)
     void* (*alloc)( void*, size_t size ); // alloc function
+    void* (*alloc_a)( void* arg, void*, size_t size ); // alloc function with argument (used instead of alloc when not NULL)
+    void* alloc_arg;             // argument of alloc_a or of the shared alloc function (alloc == alloc_a == NULL)
     size_t   block_size;
 };
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+static void* btree_vd_s_alloc( btree_vd_s* o, void* ptr, size_t size )
+{
+    if( o->alloc_a ) return o->alloc_a( o->alloc_arg, ptr, size );
+    if( o->alloc   ) return o->alloc( ptr, size );
+    return btree_shared_alloc( o->alloc_arg, ptr, size );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+btree_vd_s* btree_vd_s_create_a( void* (*alloc)( void* arg, void*, size_t size ), void* arg )
+{
+    btree_vd_s* o = alloc( arg, NULL, sizeof( btree_vd_s ) );
+    o->alloc     = NULL;
+    o->alloc_a   = alloc;
+    o->alloc_arg = arg;
+    o->root      = NULL;
+    o->chain_beg = NULL;
+    o->chain_end = NULL;
+    o->chain_ins = NULL;
+    o->del_chain = NULL;
+    o->block_size = 1024;
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+btree_vd_s* btree_vd_s_create_shared( void* arg )
+{
+    btree_vd_s* o = btree_vd_s_create_a( btree_shared_alloc, arg );
+    o->alloc_a = NULL; // resolved per call (s. btree_vd_s_alloc)
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 btree_vd_s* btree_vd_s_create( void* (*alloc)( void*, size_t size ) )
 {
     btree_vd_s* o = NULL;
@@ -994,6 +1071,8 @@ btree_vd_s* btree_vd_s_create( void* (*alloc)( void*, size_t size ) )
         o = alloc( NULL, sizeof( btree_vd_s ) );
         o->alloc = alloc;
     }
+    o->alloc_a   = NULL;
+    o->alloc_arg = NULL;
     o->root      = NULL;
     o->chain_beg = NULL;
     o->chain_end = NULL;
@@ -1013,11 +1092,11 @@ void btree_vd_s_discard( btree_vd_s* o )
     while( chain_beg )
     {
         btree_node_vd_s* new_beg = *( btree_node_vd_s** )( chain_beg + o->block_size );
-        o->alloc( chain_beg, 0 );
+        btree_vd_s_alloc( o, chain_beg, 0 );
         chain_beg = new_beg;
     }
 
-    o->alloc( o, 0 );
+    btree_vd_s_alloc( o, o, 0 );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -1035,7 +1114,7 @@ btree_node_vd_s* btree_vd_s_new_node( btree_vd_s* o )
     {
         if( o->chain_ins == o->chain_end )
         {
-            btree_node_vd_s* new_ptr = o->alloc( NULL, o->block_size * sizeof( btree_node_vd_s ) + sizeof( btree_node_vd_s* ) );
+            btree_node_vd_s* new_ptr = btree_vd_s_alloc( o, NULL, o->block_size * sizeof( btree_node_vd_s ) + sizeof( btree_node_vd_s* ) );
             if( !o->chain_beg )
             {
                 o->chain_beg = new_ptr;
@@ -47,6 +47,14 @@ SOFTWARE.
 #include <stddef.h>
 #include <stdbool.h>
 
+/**********************************************************************************************************************/
+/**********************************************************************************************************************/
+
+/** Sets the alloc function of shared trees (s. btree_*_s_create_shared) for the calling process.
+ *  Function addresses differ between processes, hence each process sets it before using shared trees.
+ */
+void btree_set_shared_alloc( void* (*alloc)( void* arg, void*, size_t size ) );
+
 /**********************************************************************************************************************/
 /**********************************************************************************************************************/
 // tree of void* as key and size_t as value
@@ -60,6 +68,15 @@ typedef struct btree_ps_s btree_ps_s;
 /// Creates a new btree_ip
 btree_ps_s* btree_ps_s_create( void* (*alloc)( void*, size_t size ) );
 
+/// Creates a new btree_ip using an alloc function with argument (e.g. to carve nodes from a specific memory region)
+btree_ps_s* btree_ps_s_create_a( void* (*alloc)( void* arg, void*, size_t size ), void* arg );
+
+/** Creates a new btree_ip residing in memory shared with or persisted by other processes.
+ *  The tree holds no function address. Allocations use the shared alloc function set by the calling process
+ *  (s. btree_set_shared_alloc) with argument 'arg', which must be valid in all processes.
+ */
+btree_ps_s* btree_ps_s_create_shared( void* arg );
+
 /// Deletes a btree_ip
 void btree_ps_s_discard( btree_ps_s* o );
 
@@ -113,6 +130,15 @@ typedef struct btree_vd_s btree_vd_s;
 /// Creates a new btree_vd (allows to specify alloc function because this tree type is used in memory management)
 btree_vd_s* btree_vd_s_create( void* (*alloc)( void*, size_t size ) );
 
+/// Creates a new btree_vd using an alloc function with argument (e.g. to carve nodes from a specific memory region)
+btree_vd_s* btree_vd_s_create_a( void* (*alloc)( void* arg, void*, size_t size ), void* arg );
+
+/** Creates a new btree_vd residing in memory shared with or persisted by other processes.
+ *  The tree holds no function address. Allocations use the shared alloc function set by the calling process
+ *  (s. btree_set_shared_alloc) with argument 'arg', which must be valid in all processes.
+ */
+btree_vd_s* btree_vd_s_create_shared( void* arg );
+
 /// Deletes a btree_vd
 void btree_vd_s_discard( btree_vd_s* o );
 
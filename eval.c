@@ -30,9 +30,31 @@ SOFTWARE.
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 
+#if defined( __unix__ ) || defined( __APPLE__ )
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <sys/wait.h>
+    #include <sys/resource.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+#endif
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <sys/ioctl.h>
+#endif
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+    #include <x86intrin.h>
+#elif defined( _M_X64 ) || defined( _M_IX86 )
+    #include <intrin.h>
+#endif
+
 #include "tbman.h"
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -81,6 +103,214 @@ static inline uint32_t xsg_u2( uint32_t rval )
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+/// cycle counter (time stamp counter or virtual counter); falls back to wall clock nanoseconds
+static inline uint64_t cycle_count( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+    return __rdtsc();
+#elif defined( __aarch64__ )
+    uint64_t v;
+    __asm__ volatile( "mrs %0, cntvct_el0" : "=r"( v ) );
+    return v;
+#else
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return ( uint64_t )ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/// nanoseconds per cycle_count tick (calibrated once against the wall clock)
+static double cycle_ns( void )
+{
+    static double ns = 0;
+    if( ns > 0 ) return ns;
+    struct timespec ts0, ts1;
+    timespec_get( &ts0, TIME_UTC );
+    uint64_t c0 = cycle_count();
+    do { timespec_get( &ts1, TIME_UTC ); } while( ( ts1.tv_sec - ts0.tv_sec ) * 1E9 + ( ts1.tv_nsec - ts0.tv_nsec ) < 2E7 );
+    uint64_t c1 = cycle_count();
+    ns = ( ( ts1.tv_sec - ts0.tv_sec ) * 1E9 + ( ts1.tv_nsec - ts0.tv_nsec ) ) / ( double )( c1 - c0 );
+    return ns;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Hardware and OS counters of the calling thread over a benchmark phase.
+ *  Hardware events (cycles, instructions, cache misses, dTLB load misses) are read via perf_event_open where
+ *  available (linux; may require /proc/sys/kernel/perf_event_paranoid <= 2); page faults via getrusage (POSIX).
+ *  Unavailable counters are omitted from the report.
+ */
+#define HW_EVENTS 4
+
+static const char* hw_event_name[ HW_EVENTS ] = { "cycles", "instr", "cache-miss", "dtlb-miss" };
+
+typedef struct hw_counters_s
+{
+    int fd[ HW_EVENTS ];
+    bool valid[ HW_EVENTS ];
+    double value[ HW_EVENTS ];
+    bool faults_valid;
+    double minor_faults;
+    double major_faults;
+} hw_counters_s;
+
+#ifdef __linux__
+static int hw_event_open( uint32_t type, uint64_t config )
+{
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+#endif
+
+static void hw_counters_s_start( hw_counters_s* o )
+{
+    memset( o, 0, sizeof( *o ) );
+    for( size_t i = 0; i < HW_EVENTS; i++ ) o->fd[ i ] = -1;
+
+#ifdef __linux__
+    o->fd[ 0 ] = hw_event_open( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+    o->fd[ 1 ] = hw_event_open( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+    o->fd[ 2 ] = hw_event_open( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+    o->fd[ 3 ] = hw_event_open
+    (
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 )
+    );
+    for( size_t i = 0; i < HW_EVENTS; i++ ) if( o->fd[ i ] >= 0 ) ioctl( o->fd[ i ], PERF_EVENT_IOC_RESET, 0 );
+#endif
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+    {
+        o->faults_valid = true;
+        o->minor_faults = usage.ru_minflt;
+        o->major_faults = usage.ru_majflt;
+    }
+#endif
+
+#ifdef __linux__
+    for( size_t i = 0; i < HW_EVENTS; i++ ) if( o->fd[ i ] >= 0 ) ioctl( o->fd[ i ], PERF_EVENT_IOC_ENABLE, 0 );
+#endif
+}
+
+static void hw_counters_s_stop( hw_counters_s* o )
+{
+#ifdef __linux__
+    for( size_t i = 0; i < HW_EVENTS; i++ ) if( o->fd[ i ] >= 0 ) ioctl( o->fd[ i ], PERF_EVENT_IOC_DISABLE, 0 );
+#endif
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+    struct rusage usage;
+    if( o->faults_valid && getrusage( RUSAGE_SELF, &usage ) == 0 )
+    {
+        o->minor_faults = usage.ru_minflt - o->minor_faults;
+        o->major_faults = usage.ru_majflt - o->major_faults;
+    }
+    else
+    {
+        o->faults_valid = false;
+    }
+#endif
+
+#ifdef __linux__
+    for( size_t i = 0; i < HW_EVENTS; i++ )
+    {
+        if( o->fd[ i ] < 0 ) continue;
+        uint64_t value = 0;
+        o->valid[ i ] = read( o->fd[ i ], &value, sizeof( value ) ) == sizeof( value );
+        o->value[ i ] = value;
+        close( o->fd[ i ] );
+        o->fd[ i ] = -1;
+    }
+#endif
+}
+
+/// subtracts the counters of an overhead run (clamped at 0)
+static void hw_counters_s_sub( hw_counters_s* o, const hw_counters_s* overhead )
+{
+    for( size_t i = 0; i < HW_EVENTS; i++ )
+    {
+        o->value[ i ] = ( o->value[ i ] > overhead->value[ i ] ) ? o->value[ i ] - overhead->value[ i ] : 0;
+    }
+}
+
+/// prints available counters per operation, preceded by '|' (no line break)
+static void hw_counters_s_print( const hw_counters_s* o, size_t ops )
+{
+    double div = ops > 0 ? ops : 1;
+    if( o->faults_valid || o->valid[ 0 ] ) printf( " |" );
+    for( size_t i = 0; i < HW_EVENTS; i++ ) if( o->valid[ i ] ) printf( " %s %.1f", hw_event_name[ i ], o->value[ i ] / div );
+    if( o->faults_valid ) printf( " minflt %.4f majflt %.4f", o->minor_faults / div, o->major_faults / div );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Latency histogram of cycle_count ticks.
+ *  Log-linear buckets: values below 16 are exact; above, each power of two is split into 16 buckets (error < 6.25%).
+ */
+#define LATENCY_BUCKETS 1024
+
+typedef struct latency_histogram_s
+{
+    size_t count[ LATENCY_BUCKETS ];
+    size_t total;
+    uint64_t sum;
+    uint64_t max;
+} latency_histogram_s;
+
+static inline void latency_histogram_s_add( latency_histogram_s* o, uint64_t ticks )
+{
+    size_t shift = 0;
+    while( ( ticks >> shift ) >= 32 ) shift++;
+    size_t idx = ( ticks < 16 ) ? ticks : 16 * ( shift + 1 ) + ( ( ticks >> shift ) - 16 );
+    o->count[ idx ]++;
+    o->total++;
+    o->sum += ticks;
+    if( ticks > o->max ) o->max = ticks;
+}
+
+/// upper bound of the q-quantile (0 < q <= 1) in ns
+static double latency_histogram_s_quantile( const latency_histogram_s* o, double q )
+{
+    size_t target = q * o->total;
+    if( target < 1 ) target = 1;
+    size_t sum = 0;
+    for( size_t i = 0; i < LATENCY_BUCKETS; i++ )
+    {
+        sum += o->count[ i ];
+        if( sum < target ) continue;
+        uint64_t upper = ( i < 16 ) ? i : ( ( uint64_t )( i % 16 + 17 ) << ( i / 16 - 1 ) ) - 1;
+        if( upper > o->max ) upper = o->max;
+        return upper * cycle_ns();
+    }
+    return o->max * cycle_ns();
+}
+
+static void latency_histogram_s_print( const latency_histogram_s* o, const char* name )
+{
+    printf
+    (
+        "%s: mean %6.0fns, p50 %6.0fns, p90 %6.0fns, p99 %7.0fns, p999 %8.0fns, max %9.0fns\n",
+        name,
+        o->total > 0 ? ( o->sum * cycle_ns() ) / o->total : 0,
+        latency_histogram_s_quantile( o, 0.5 ),
+        latency_histogram_s_quantile( o, 0.9 ),
+        latency_histogram_s_quantile( o, 0.99 ),
+        latency_histogram_s_quantile( o, 0.999 ),
+        o->max * cycle_ns()
+    );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 /** Rigorous Monte Carlo based Memory Manager Test.
  *
  *  This routine evaluates the integrity and speed of a chosen memory
@@ -264,8 +494,10 @@ void alloc_challenge
     // Dummy loops: Assessment of overhead time, which is to be
     // subtracted from time needed for the principal loop
     clock_t overhead_time = 0;
+    hw_counters_s overhead_counters;
     {
         size_t* size_buf = malloc( table_size * sizeof( size_t ) );
+        hw_counters_s_start( &overhead_counters );
         clock_t time = clock();
         for( size_t j = 0; j < cycles; j++ )
         {
@@ -285,13 +517,16 @@ void alloc_challenge
                 }
             }
         }
-        free( size_buf );
         overhead_time = clock() - time;
+        hw_counters_s_stop( &overhead_counters );
+        free( size_buf );
     }
 
     clock_t local_overhead_time = 0;
+    hw_counters_s local_overhead_counters;
     {
         size_t* size_buf = malloc( table_size * sizeof( size_t ) );
+        hw_counters_s_start( &local_overhead_counters );
         clock_t time = clock();
         for( size_t k = 0; k < cycles; k++ )
         {
@@ -316,12 +551,15 @@ void alloc_challenge
                 }
             }
         }
-        free( size_buf );
         local_overhead_time = clock() - time;
+        hw_counters_s_stop( &local_overhead_counters );
+        free( size_buf );
     }
 
     // Equilibrium speed test: malloc, free
     {
+        hw_counters_s counters;
+        hw_counters_s_start( &counters );
         clock_t time = clock();
         for( size_t j = 0; j < cycles; j++ )
         {
@@ -342,12 +580,18 @@ void alloc_challenge
             }
         }
         time = clock() - time - overhead_time;
+        hw_counters_s_stop( &counters );
+        hw_counters_s_sub( &counters, &overhead_counters );
         size_t ns = ( 1E9 * time ) / ( CLOCKS_PER_SEC  * cycles  * table_size );
-        printf( "speed test alloc-free (general): %6zuns per call\n", ns );
+        printf( "speed test alloc-free (general): %6zuns per call", ns );
+        hw_counters_s_print( &counters, cycles * table_size );
+        printf( "\n" );
     }
 
     // Equilibrium speed test: realloc
     {
+        hw_counters_s counters;
+        hw_counters_s_start( &counters );
         clock_t time = clock();
         for( size_t j = 0; j < cycles; j++ )
         {
@@ -361,12 +605,18 @@ void alloc_challenge
             }
         }
         time = clock() - time - overhead_time;
+        hw_counters_s_stop( &counters );
+        hw_counters_s_sub( &counters, &overhead_counters );
         size_t ns = ( 1E9 * time ) / ( CLOCKS_PER_SEC  * cycles  * table_size );
-        printf( "speed test realloc (general)   : %6zuns per call\n", ns );
+        printf( "speed test realloc (general)   : %6zuns per call", ns );
+        hw_counters_s_print( &counters, cycles * table_size );
+        printf( "\n" );
     }
 
     // Local speed test: malloc, free
     {
+        hw_counters_s counters;
+        hw_counters_s_start( &counters );
         clock_t time = clock();
         for( size_t k = 0; k < cycles; k++ )
         {
@@ -392,9 +642,13 @@ void alloc_challenge
             }
         }
         time = clock() - time - local_overhead_time;
+        hw_counters_s_stop( &counters );
+        hw_counters_s_sub( &counters, &local_overhead_counters );
         size_t total_cycles = cycles * local_cycles  * local_table_size;
         size_t ns = ( 1E9 * time ) / ( CLOCKS_PER_SEC  * total_cycles );
-        printf( "speed test alloc-free (local)  : %6zuns per call\n", ns );
+        printf( "speed test alloc-free (local)  : %6zuns per call", ns );
+        hw_counters_s_print( &counters, total_cycles );
+        printf( "\n" );
     }
 
     // cleanup
@@ -406,6 +660,88 @@ void alloc_challenge
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+/** Tail latency: Runs the equilibrium phases of alloc_challenge timing each call with cycle_count.
+ *  Reports the latency distribution per phase, revealing spikes (e.g. pool creation, btree rebalancing)
+ *  which averaged times hide.
+ */
+static void alloc_latency_challenge( fp_alloc alloc, size_t table_size, size_t cycles, size_t max_alloc, uint32_t seed )
+{
+    void**   data_table = calloc( table_size, sizeof( void* ) );
+    size_t*  size_table = calloc( table_size, sizeof( size_t ) );
+    latency_histogram_s* hist = malloc( sizeof( latency_histogram_s ) );
+    uint32_t rval = seed;
+
+    // fill to equilibrium
+    for( size_t i = 0; i < table_size; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval % table_size;
+        rval = xsg_u2( rval );
+        size_t size = pow( ( double )max_alloc, rval * pow( 2.0, -32 ) );
+        data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], data_table[ idx ] ? 0 : size, &size_table[ idx ] );
+    }
+
+    // general: malloc, free
+    memset( hist, 0, sizeof( *hist ) );
+    for( size_t j = 0; j < cycles * table_size; j++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval % table_size;
+        rval = xsg_u2( rval );
+        size_t size = pow( ( double )max_alloc, rval * pow( 2.0, -32 ) );
+        uint64_t time = cycle_count();
+        data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], data_table[ idx ] ? 0 : size, &size_table[ idx ] );
+        latency_histogram_s_add( hist, cycle_count() - time );
+    }
+    latency_histogram_s_print( hist, "latency alloc-free (general)" );
+
+    // general: realloc
+    memset( hist, 0, sizeof( *hist ) );
+    for( size_t j = 0; j < cycles * table_size; j++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval % table_size;
+        rval = xsg_u2( rval );
+        size_t size = pow( ( double )max_alloc, rval * pow( 2.0, -32 ) );
+        uint64_t time = cycle_count();
+        data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], size, &size_table[ idx ] );
+        latency_histogram_s_add( hist, cycle_count() - time );
+    }
+    latency_histogram_s_print( hist, "latency realloc (general)   " );
+
+    // local: malloc, free
+    size_t local_table_size = 10 < table_size ? 10 : table_size;
+    size_t local_cycles     = table_size / local_table_size;
+    memset( hist, 0, sizeof( *hist ) );
+    for( size_t k = 0; k < cycles; k++ )
+    {
+        size_t local_seed = ( rval = xsg_u2( rval ) );
+        for( size_t j = 0; j < local_cycles; j++ )
+        {
+            rval = local_seed;
+            for( size_t i = 0; i < local_table_size; i++ )
+            {
+                rval = xsg_u2( rval );
+                size_t idx = rval % table_size;
+                rval = xsg_u2( rval );
+                size_t size = pow( ( double )max_alloc, rval * pow( 2.0, -32 ) );
+                uint64_t time = cycle_count();
+                data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], data_table[ idx ] ? 0 : size, &size_table[ idx ] );
+                latency_histogram_s_add( hist, cycle_count() - time );
+            }
+        }
+    }
+    latency_histogram_s_print( hist, "latency alloc-free (local)  " );
+
+    for( size_t i = 0; i < table_size; i++ ) data_table[ i ] = alloc( data_table[ i ], size_table[ i ], 0, NULL );
+
+    free( hist );
+    free( size_table );
+    free( data_table );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 // generalized alloc function purely based on stdlib
 static inline void* external_alloc( void* current_ptr, size_t requested_bytes, size_t* granted_bytes )
 {
@@ -451,6 +787,42 @@ static inline void* tbman_nalloc_no_current_bytes( void* current_ptr, size_t cur
     return tbman_alloc( current_ptr, requested_bytes, granted_bytes );
 }
 
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// dedicated manager of the calling thread (s. tbman_s_nalloc_thread)
+static _Thread_local tbman_s* thread_man = NULL;
+
+// alloc function using the calling thread's dedicated manager
+static inline void* tbman_s_nalloc_thread( void* current_ptr, size_t current_bytes, size_t requested_bytes, size_t* granted_bytes )
+{
+    return tbman_s_nalloc( thread_man, current_ptr, current_bytes, requested_bytes, granted_bytes );
+}
+
+// alloc function using the calling thread's dedicated manager without passing current_bytes
+static inline void* tbman_s_alloc_thread( void* current_ptr, size_t current_bytes, size_t requested_bytes, size_t* granted_bytes )
+{
+    return tbman_s_alloc( thread_man, current_ptr, requested_bytes, granted_bytes );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// true when the library was built with TBMAN_LOCK_NONE as default (global manager is not thread-safe)
+static bool default_unlocked( void )
+{
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    return params.lock_policy == TBMAN_LOCK_NONE;
+}
+
+/// opens a dedicated manager with a lock (regardless of the default lock policy)
+static tbman_s* tbman_s_open_locked( void )
+{
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    if( params.lock_policy == TBMAN_LOCK_NONE ) params.lock_policy = TBMAN_LOCK_MUTEX;
+    return tbman_s_create_with( &params );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 /** Test of tbman diagnostic features */
 
@@ -504,46 +876,2593 @@ static void tbman_s_diagnostic_test( void )
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
+/** Test of arena */
 
-void tbman_test( void )
+static void tbman_arena_s_test( void )
 {
-    size_t table_size = 100000;
-    size_t cycles     = 10;
-    size_t max_alloc  = 65536;
-    size_t seed       = 1237;
+    tbman_s* man = tbman_s_open();
+    tbman_arena_s* arena = tbman_arena_s_create( man, 0 );
 
-    bool verbose      = false; // set 'true' for more expressive test results
+    // default chunks are served from the parent's pools
+    size_t class_index = 0;
+    tbman_arena_s_alloc( arena, 1 );
+    tbman_s_good_size( man, tbman_arena_s_total_space( arena ), &class_index );
+    ASSERT( class_index != TBMAN_CLASS_EXTERNAL );
+
+    uint32_t rval = 1234;
+    for( size_t i = 0; i < 1000; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t size = 1 + rval % 200;
+        uint8_t* data = tbman_arena_s_alloc( arena, size );
+        ASSERT( ( ( size_t )data & ( ( size & ( ~size + 1 ) ) - 1 ) & 0xFF ) == 0 );
+        for( size_t j = 0; j < size; j++ ) data[ j ] = j;
+    }
+
+    tbman_arena_mark_s mark = tbman_arena_s_mark( arena );
+    size_t space = tbman_arena_s_total_space( arena );
+    void* ptr1 = tbman_arena_s_alloc( arena, 16 );
+    for( size_t i = 0; i < 1000; i++ ) tbman_arena_s_alloc( arena, 100 );
+    tbman_arena_s_alloc( arena, 1000000 ); // dedicated chunk
+
+    tbman_arena_s_release( arena, mark );
+    ASSERT( tbman_arena_s_total_space( arena ) == space );
+    ASSERT( tbman_arena_s_alloc( arena, 16 ) == ptr1 );
+
+    tbman_arena_s_clear( arena );
+    ASSERT( tbman_arena_s_total_space( arena ) == 0 );
+    ASSERT( tbman_s_total_instances( man ) == 1 ); // arena object itself
+
+    tbman_arena_s_discard( arena );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_s_close( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of slab */
+
+static void slab_test_init( void* arg, void* obj ) { ( *( size_t* )arg )++; *( uint32_t* )obj = 0xC0FFEE; }
+static void slab_test_down( void* arg, void* obj ) { ( *( size_t* )arg )--; ASSERT( *( uint32_t* )obj == 0xC0FFEE ); }
+
+static void tbman_slab_s_test( void )
+{
+    tbman_s* man = tbman_s_open();
+    size_t constructed = 0;
+    tbman_slab_s* slab = tbman_slab_s_create( man, 40, 100, slab_test_init, slab_test_down, &constructed );
+    ASSERT( tbman_slab_s_granted_size( slab ) >= 40 );
+
+    void* obj_arr[ 1000 ];
+    for( size_t i = 0; i < 1000; i++ ) obj_arr[ i ] = tbman_slab_s_alloc( slab );
+    ASSERT( constructed == 1000 );
+    ASSERT( tbman_s_total_instances( man ) == 1002 ); // including slab object and cache array
+
+    for( size_t i = 0; i < 1000; i++ ) tbman_slab_s_free( slab, obj_arr[ i ] );
+    ASSERT( tbman_slab_s_cached( slab ) == 100 );
+    ASSERT( constructed == 100 );
+
+    // cached objects are reused without construction
+    for( size_t i = 0; i < 100; i++ ) obj_arr[ i ] = tbman_slab_s_alloc( slab );
+    ASSERT( constructed == 100 );
+    for( size_t i = 0; i < 100; i++ ) tbman_slab_s_free( slab, obj_arr[ i ] );
+
+    tbman_slab_s_discard( slab );
+    ASSERT( constructed == 0 );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_s_close( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of manager reset */
+
+static int compare_ptr( const void* a, const void* b )
+{
+    uintptr_t va = ( uintptr_t )*( void* const* )a;
+    uintptr_t vb = ( uintptr_t )*( void* const* )b;
+    return ( va > vb ) - ( va < vb );
+}
 
-    printf( "Memory Manager Evaluation:\n");
+static void tbman_s_reset_test( void )
+{
+    tbman_s* man = tbman_s_open();
+    uint32_t rval = 1234;
+
+    for( size_t j = 0; j < 3; j++ )
     {
-        printf( "\nmalloc, free, realloc (stdlib) ...\n");
-        alloc_challenge( external_nalloc, table_size, cycles, max_alloc, seed, true, verbose );
+        for( size_t i = 0; i < 10000; i++ )
+        {
+            rval = xsg_u2( rval );
+            size_t size = 1 + rval % 20000;
+            uint8_t* data = tbman_s_alloc( man, NULL, size, NULL );
+            data[ 0 ] = data[ size - 1 ] = 1;
+        }
+        ASSERT( tbman_s_total_instances( man ) == 10000 );
+        tbman_s_reset( man, j );
+        ASSERT( tbman_s_total_instances(     man ) == 0 );
+        ASSERT( tbman_s_total_granted_space( man ) == 0 );
     }
 
+    // freeing a random subset in random order before resetting; instances handed out afterwards must be distinct
+    size_t block_size = 64;
+    size_t n = 2 * 0x10000 / block_size; // two pools (default pool size)
+    void** data = malloc( sizeof( void* ) * n );
+    for( size_t i = 0; i < n; i++ ) data[ i ] = tbman_s_alloc( man, NULL, block_size, NULL );
+    for( size_t i = n - 1; i > 0; i-- )
     {
-        printf( "\ntbman_malloc, tbman_free, tbman_realloc ...\n");
-        alloc_challenge( tbman_nalloc_no_current_bytes, table_size, cycles, max_alloc, seed, true, verbose );
+        rval = xsg_u2( rval );
+        size_t k = rval % ( i + 1 );
+        void* swap = data[ i ]; data[ i ] = data[ k ]; data[ k ] = swap;
     }
+    for( size_t i = 0; i < n / 2; i++ ) tbman_s_free( man, data[ i ] );
+    tbman_s_reset( man, 2 );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+
+    for( size_t i = 0; i < n; i++ ) data[ i ] = tbman_s_alloc( man, NULL, block_size, NULL );
+    qsort( data, n, sizeof( void* ), compare_ptr );
+    for( size_t i = 1; i < n; i++ ) ASSERT( data[ i ] != data[ i - 1 ] );
+    for( size_t i = 0; i < n; i++ ) tbman_s_free( man, data[ i ] );
+    ASSERT( tbman_s_check_consistency( man ) );
+    free( data );
+
+    tbman_s_alloc( man, NULL, 100, NULL );
+    tbman_s_set_leak_warning( man, false ); // discarding with open instance
+    tbman_s_close( man );
+}
 
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of backing memory providers */
+
+typedef struct counting_provider_s
+{
+    const tbman_provider_s* base;
+    size_t reserves;
+    size_t releases;
+    size_t reserved_bytes;
+} counting_provider_s;
+
+static void* counting_reserve( void* arg, size_t size )
+{
+    counting_provider_s* o = arg;
+    o->reserves++;
+    o->reserved_bytes += size;
+    return o->base->reserve( o->base->arg, size );
+}
+
+static void* counting_reserve_aligned( void* arg, size_t align, size_t size )
+{
+    counting_provider_s* o = arg;
+    o->reserves++;
+    o->reserved_bytes += size;
+    return o->base->reserve_aligned( o->base->arg, align, size );
+}
+
+static void counting_release( void* arg, void* ptr, size_t size )
+{
+    counting_provider_s* o = arg;
+    o->releases++;
+    o->reserved_bytes -= size;
+    o->base->release( o->base->arg, ptr, size );
+}
+
+static void provider_test_run( const tbman_provider_s* provider )
+{
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    params.provider = provider;
+    tbman_s* man = tbman_s_create_with( &params );
+
+    void* ptr_arr[ 1000 ];
+    uint32_t rval = 1234;
+    for( size_t i = 0; i < 1000; i++ )
     {
-        printf( "\ntbman_malloc, tbman_nfree, tbman_nrealloc ...\n");
-        alloc_challenge( tbman_nalloc, table_size, cycles, max_alloc, seed, true, verbose );
+        rval = xsg_u2( rval );
+        size_t size = 1 + rval % 100000;
+        uint8_t* data = tbman_s_alloc( man, NULL, size, NULL );
+        data[ 0 ] = data[ size - 1 ] = 1;
+        ptr_arr[ i ] = data;
     }
 
+    // shrinking large blocks in place decommits their tail (if supported by the provider)
+    for( size_t i = 0; i < 1000; i += 2 )
     {
-        printf( "\ndiagnostic test ... ");
-        tbman_s_diagnostic_test();
-        printf( "success!\n");
+        size_t granted = 0;
+        ptr_arr[ i ] = tbman_s_alloc( man, ptr_arr[ i ], tbman_s_granted_space( man, ptr_arr[ i ] ) * 3 / 4 + 1, &granted );
+        ( ( uint8_t* )ptr_arr[ i ] )[ granted - 1 ] = 1;
     }
+
+    for( size_t i = 0; i < 1000; i += 3 ) tbman_s_free( man, ptr_arr[ i ] );
+    tbman_s_reset( man, 1 );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    uint8_t* data = tbman_s_alloc( man, NULL, 100, NULL );
+    data[ 0 ] = 1;
+    tbman_s_free( man, data );
+    tbman_s_discard( man );
+}
+
+static void tbman_provider_test( void )
+{
+    counting_provider_s counter = { .base = tbman_provider_system() };
+    tbman_provider_s provider =
+    {
+        .arg = &counter,
+        .reserve = counting_reserve,
+        .release = counting_release,
+        .reserve_aligned = counting_reserve_aligned
+    };
+
+    provider_test_run( &provider );
+    ASSERT( counter.reserves > 0 );
+    ASSERT( counter.reserves == counter.releases );
+    ASSERT( counter.reserved_bytes == 0 );
+
+    if( tbman_provider_mmap() ) provider_test_run( tbman_provider_mmap() );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
+/** Test of provider calls outside the lock: A slow provider must not extend the lock hold time of batch allocation,
+ *  batch freeing (also draining deferred frees), in-place expansion and resetting.
+ */
 
-int main( void )
+typedef struct slow_provider_s
 {
-    tbman_open();
-    tbman_test();
+    const tbman_provider_s* base;
+    size_t slow_size; // calls on blocks of this size are delayed (expansion is always delayed)
+} slow_provider_s;
+
+static const clock_t slow_provider_delay = CLOCKS_PER_SEC / 50;
+
+static void slow_provider_wait( void )
+{
+    clock_t time = clock();
+    while( clock() - time < slow_provider_delay );
+}
+
+static void* slow_reserve( void* arg, size_t size )
+{
+    slow_provider_s* o = arg;
+    if( size == o->slow_size ) slow_provider_wait();
+    return o->base->reserve( o->base->arg, size );
+}
+
+static void* slow_reserve_aligned( void* arg, size_t align, size_t size )
+{
+    slow_provider_s* o = arg;
+    if( size == o->slow_size ) slow_provider_wait();
+    return o->base->reserve_aligned( o->base->arg, align, size );
+}
+
+static void slow_release( void* arg, void* ptr, size_t size )
+{
+    slow_provider_s* o = arg;
+    if( size == o->slow_size ) slow_provider_wait();
+    o->base->release( o->base->arg, ptr, size );
+}
+
+static size_t slow_expand( void* arg, void* ptr, size_t size, size_t min_size, size_t max_size )
+{
+    slow_provider_s* o = arg;
+    slow_provider_wait();
+    return o->base->expand ? o->base->expand( o->base->arg, ptr, size, min_size, max_size ) : 0;
+}
+
+static void tbman_provider_unlocked_test( void )
+{
+    slow_provider_s slow = { .base = tbman_provider_mmap() ? tbman_provider_mmap() : tbman_provider_system() };
+    tbman_provider_s provider =
+    {
+        .arg = &slow,
+        .reserve = slow_reserve,
+        .release = slow_release,
+        .reserve_aligned = slow_reserve_aligned,
+        .expand = slow_expand
+    };
+
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    params.provider = &provider;
+    params.lock_timing = true;
+    tbman_s* man = tbman_s_create_with( &params );
+
+    // external blocks (btree metadata is allocated under the lock and not delayed)
+    size_t size = params.max_block_size * 4 + 16;
+    slow.slow_size = size;
+    void* ptr_arr[ 8 ];
+    ASSERT( tbman_s_alloc_batch( man, size, 8, ptr_arr ) == size );
+    for( size_t i = 0; i < 8; i++ ) ( ( uint8_t* )ptr_arr[ i ] )[ size - 1 ] = 1;
+
+    size_t granted = 0;
+    if( tbman_s_expand( man, ptr_arr[ 0 ], size, size * 2, size * 2, &granted ) )
+    {
+        ASSERT( granted >= size * 2 );
+        ASSERT( tbman_s_granted_space( man, ptr_arr[ 0 ] ) == granted );
+        ( ( uint8_t* )ptr_arr[ 0 ] )[ granted - 1 ] = 1;
+    }
+
+    tbman_s_free_batch( man, ptr_arr, NULL, 4 );
+    for( size_t i = 4; i < 8; i++ ) tbman_s_free_deferred( man, ptr_arr[ i ], size );
+    tbman_s_flush_deferred( man );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+
+    // resetting releases open external blocks
+    for( size_t i = 0; i < 4; i++ ) tbman_s_alloc( man, NULL, size, NULL );
+    tbman_s_reset( man, 0 );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+
+    tbman_lock_stats_s stats = tbman_s_lock_stats( man );
+    tbman_s_discard( man );
+    ASSERT( stats.max_hold_ns < ( 1E9 * slow_provider_delay ) / CLOCKS_PER_SEC );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Lock policy: Single-threaded alloc-free cycles on a dedicated manager */
+
+static void lock_policy_challenge( tbman_lock_policy policy, const char* name, size_t cycles )
+{
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    params.lock_policy = policy;
+    tbman_s* man = tbman_s_create_with( &params );
+
+    void* ptr_arr[ 16 ] = { NULL };
+    uint32_t rval = 1234;
+    clock_t time = clock();
+    for( size_t i = 0; i < cycles; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval & 15;
+        if( ptr_arr[ idx ] )
+        {
+            tbman_s_nfree( man, ptr_arr[ idx ], 64 );
+            ptr_arr[ idx ] = NULL;
+        }
+        else
+        {
+            ptr_arr[ idx ] = tbman_s_alloc( man, NULL, 64, NULL );
+        }
+    }
+    time = clock() - time;
+
+    for( size_t i = 0; i < 16; i++ ) tbman_s_free( man, ptr_arr[ i ] );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_s_discard( man );
+
+    size_t ns = ( 1E9 * time ) / ( CLOCKS_PER_SEC * cycles );
+    printf( "%s: %6zuns per call\n", name, ns );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Lock policy: Multi-threaded alloc-free cycles on a shared manager (wall clock time) */
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+
+/// wall clock time in seconds
+static double wall_time( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+typedef struct lock_thread_arg_s { tbman_s* man; size_t cycles; uint32_t seed; } lock_thread_arg_s;
+
+static void* lock_thread_func( void* arg )
+{
+    lock_thread_arg_s* o = arg;
+    void* ptr_arr[ 256 ] = { NULL };
+    size_t size_arr[ 256 ] = { 0 };
+    uint32_t rval = o->seed;
+    for( size_t i = 0; i < o->cycles; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval & 255;
+        if( ptr_arr[ idx ] )
+        {
+            tbman_s_nfree( o->man, ptr_arr[ idx ], size_arr[ idx ] );
+            ptr_arr[ idx ] = NULL;
+        }
+        else
+        {
+            size_arr[ idx ] = 8 + ( ( rval >> 8 ) & 255 );
+            ptr_arr[ idx ] = tbman_s_alloc( o->man, NULL, size_arr[ idx ], NULL );
+        }
+    }
+    for( size_t i = 0; i < 256; i++ ) if( ptr_arr[ i ] ) tbman_s_nfree( o->man, ptr_arr[ i ], size_arr[ i ] );
+    return NULL;
+}
+
+static void lock_policy_mt_challenge( tbman_lock_policy policy, const char* name, size_t threads, size_t cycles )
+{
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    params.lock_policy = policy;
+    tbman_s* man = tbman_s_create_with( &params );
+
+    pthread_t thread_arr[ 64 ];
+    lock_thread_arg_s arg_arr[ 64 ];
+    if( threads > 64 ) threads = 64;
+
+    double time = wall_time();
+    for( size_t i = 0; i < threads; i++ )
+    {
+        arg_arr[ i ] = ( lock_thread_arg_s ){ .man = man, .cycles = cycles, .seed = 1234 + i };
+        pthread_create( &thread_arr[ i ], NULL, lock_thread_func, &arg_arr[ i ] );
+    }
+    for( size_t i = 0; i < threads; i++ ) pthread_join( thread_arr[ i ], NULL );
+    time = wall_time() - time;
+
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_lock_stats_s stats = tbman_s_lock_stats( man );
+    tbman_s_discard( man );
+
+    printf
+    (
+        "%s: %6.1fns per call (aggregate), contended %5.2f%%, spins per contention %7.1f, sleeps %zu\n",
+        name,
+        ( time * 1E9 ) / ( threads * cycles ),
+        stats.acquisitions > 0 ? ( 100.0 * stats.contended ) / stats.acquisitions : 0,
+        stats.contended > 0 ? ( double )stats.spins / stats.contended : 0,
+        stats.sleeps
+    );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Lock hold time: One thread reallocates large instances while others run small alloc-free cycles */
+
+static void* realloc_thread_func( void* arg )
+{
+    lock_thread_arg_s* o = arg;
+    void* ptr_arr[ 16 ] = { NULL };
+    uint32_t rval = o->seed;
+    for( size_t i = 0; i < o->cycles; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval & 15;
+        size_t size = 1024 + ( xsg_u2( rval ) & ( ( 1 << 22 ) - 1 ) );
+        ptr_arr[ idx ] = tbman_s_realloc( o->man, ptr_arr[ idx ], size );
+        ( ( uint8_t* )ptr_arr[ idx ] )[ size - 1 ] = 1;
+    }
+    for( size_t i = 0; i < 16; i++ ) tbman_s_free( o->man, ptr_arr[ i ] );
+    return NULL;
+}
+
+static void lock_hold_challenge( size_t threads, size_t cycles, size_t realloc_cycles )
+{
+    tbman_params_s params;
+    tbman_params_s_init( &params );
+    if( params.lock_policy == TBMAN_LOCK_NONE ) params.lock_policy = TBMAN_LOCK_MUTEX;
+    params.lock_timing = true;
+    tbman_s* man = tbman_s_create_with( &params );
+
+    pthread_t thread_arr[ 64 ];
+    lock_thread_arg_s arg_arr[ 64 ];
+    if( threads > 64 ) threads = 64;
+
+    double time = wall_time();
+    arg_arr[ 0 ] = ( lock_thread_arg_s ){ .man = man, .cycles = realloc_cycles, .seed = 4321 };
+    pthread_create( &thread_arr[ 0 ], NULL, realloc_thread_func, &arg_arr[ 0 ] );
+    for( size_t i = 1; i < threads; i++ )
+    {
+        arg_arr[ i ] = ( lock_thread_arg_s ){ .man = man, .cycles = cycles, .seed = 1234 + i };
+        pthread_create( &thread_arr[ i ], NULL, lock_thread_func, &arg_arr[ i ] );
+    }
+    for( size_t i = 0; i < threads; i++ ) pthread_join( thread_arr[ i ], NULL );
+    time = wall_time() - time;
+
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_lock_stats_s stats = tbman_s_lock_stats( man );
+    tbman_s_discard( man );
+
+    printf( "total time ........... %.3fs\n", time );
+    printf( "lock acquisitions .... %zu\n", stats.acquisitions );
+    printf( "contended ............ %zu\n", stats.contended );
+    printf( "mean hold time ....... %.1fns\n", stats.acquisitions > 0 ? ( double )stats.hold_ns / stats.acquisitions : 0 );
+    printf( "max hold time ........ %zuns\n", stats.max_hold_ns );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Thread scaling: Each of T threads runs the equilibrium phases of alloc_challenge (alloc-free, realloc)
+ *  on its own table. Managers: global tbman, one dedicated tbman_s per thread (TBMAN_LOCK_NONE), stdlib.
+ *  Random indices and sizes are generated before timing.
+ */
+
+typedef struct scaling_thread_arg_s
+{
+    fp_alloc alloc;
+    bool dedicated;
+    size_t table_size;
+    size_t cycles;
+    size_t max_alloc;
+    uint32_t seed;
+    double begin; // wall time
+    double end;   // wall time
+} scaling_thread_arg_s;
+
+static void* scaling_thread_func( void* arg )
+{
+    scaling_thread_arg_s* o = arg;
+    size_t ops = o->table_size * o->cycles;
+    void**   data_table = calloc( o->table_size, sizeof( void* ) );
+    size_t*  size_table = calloc( o->table_size, sizeof( size_t ) );
+    size_t*  idx_arr    = malloc( ops * sizeof( size_t ) );
+    size_t*  size_arr   = malloc( ops * sizeof( size_t ) );
+
+    uint32_t rval = o->seed;
+    for( size_t i = 0; i < ops; i++ )
+    {
+        rval = xsg_u2( rval );
+        idx_arr[ i ] = rval % o->table_size;
+        rval = xsg_u2( rval );
+        size_arr[ i ] = pow( ( double )o->max_alloc, rval * pow( 2.0, -32 ) );
+        if( size_arr[ i ] == 0 ) size_arr[ i ] = 1;
+    }
+
+    if( o->dedicated )
+    {
+        tbman_params_s params;
+        tbman_params_s_init( &params );
+        params.lock_policy = TBMAN_LOCK_NONE;
+        thread_man = tbman_s_create_with( &params );
+    }
+
+    fp_alloc alloc = o->alloc;
+    o->begin = wall_time();
+
+    // alloc-free
+    for( size_t i = 0; i < ops; i++ )
+    {
+        size_t idx = idx_arr[ i ];
+        if( data_table[ idx ] == NULL )
+        {
+            data_table[ idx ] = alloc( NULL, 0, size_arr[ i ], &size_table[ idx ] );
+            *( uint8_t* )data_table[ idx ] = 1;
+        }
+        else
+        {
+            data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], 0, &size_table[ idx ] );
+        }
+    }
+
+    // realloc
+    for( size_t i = 0; i < ops; i++ )
+    {
+        size_t idx = idx_arr[ i ];
+        data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], size_arr[ i ], &size_table[ idx ] );
+        *( uint8_t* )data_table[ idx ] = 1;
+    }
+
+    o->end = wall_time();
+
+    for( size_t i = 0; i < o->table_size; i++ ) data_table[ i ] = alloc( data_table[ i ], size_table[ i ], 0, NULL );
+
+    if( o->dedicated )
+    {
+        tbman_s_discard( thread_man );
+        thread_man = NULL;
+    }
+
+    free( size_arr );
+    free( idx_arr );
+    free( size_table );
+    free( data_table );
+    return NULL;
+}
+
+/// runs T threads; returns aggregate throughput in Mops/s and mean ns per op of a thread via ns_per_op
+static double scaling_run( fp_alloc alloc, bool dedicated, size_t threads, size_t table_size, size_t cycles, size_t max_alloc, double* ns_per_op )
+{
+    pthread_t thread_arr[ 64 ];
+    scaling_thread_arg_s arg_arr[ 64 ];
+    if( threads > 64 ) threads = 64;
+
+    for( size_t i = 0; i < threads; i++ )
+    {
+        arg_arr[ i ] = ( scaling_thread_arg_s )
+        {
+            .alloc = alloc, .dedicated = dedicated, .table_size = table_size, .cycles = cycles, .max_alloc = max_alloc, .seed = 1237 + i
+        };
+        pthread_create( &thread_arr[ i ], NULL, scaling_thread_func, &arg_arr[ i ] );
+    }
+    for( size_t i = 0; i < threads; i++ ) pthread_join( thread_arr[ i ], NULL );
+
+    double begin = HUGE_VAL;
+    double end   = -HUGE_VAL;
+    double thread_time = 0;
+    for( size_t i = 0; i < threads; i++ )
+    {
+        begin = arg_arr[ i ].begin < begin ? arg_arr[ i ].begin : begin;
+        end   = arg_arr[ i ].end   > end   ? arg_arr[ i ].end   : end;
+        thread_time += arg_arr[ i ].end - arg_arr[ i ].begin;
+    }
+
+    double ops = 2.0 * table_size * cycles; // alloc-free and realloc phase
+    *ns_per_op = ( thread_time * 1E9 ) / ( threads * ops );
+    return ( threads * ops ) / ( ( end - begin ) * 1E6 );
+}
+
+static void thread_scaling_challenge( size_t table_size, size_t cycles, size_t max_alloc )
+{
+    size_t cores = sysconf( _SC_NPROCESSORS_ONLN );
+    if( cores < 1 ) cores = 1;
+    if( cores > 64 ) cores = 64;
+
+    // the global manager is not thread-safe in builds defaulting to TBMAN_LOCK_NONE
+    bool global = !default_unlocked();
+
+    printf( "threads |  tbman global     |  tbman per thread |  stdlib\n" );
+    printf( "        |  Mops/s   ns/op   |  Mops/s   ns/op   |  Mops/s   ns/op\n" );
+    for( size_t threads = 1; threads <= cores; threads = ( threads < cores && threads * 2 > cores ) ? cores : threads * 2 )
+    {
+        double g_ns = 0, d_ns, s_ns;
+        double g_mops = global ? scaling_run( tbman_nalloc, false, threads, table_size, cycles, max_alloc, &g_ns ) : 0;
+        double d_mops = scaling_run( tbman_s_nalloc_thread, true,  threads, table_size, cycles, max_alloc, &d_ns );
+        double s_mops = scaling_run( external_nalloc,       false, threads, table_size, cycles, max_alloc, &s_ns );
+        printf( "%7zu | %7.2f %7.1f   | %7.2f %7.1f   | %7.2f %7.1f\n", threads, g_mops, g_ns, d_mops, d_ns, s_mops, s_ns );
+        if( threads == cores ) break;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Producer-consumer: Producers allocate instances and pass them through a bounded queue to consumers, which free them.
+ *  Measures throughput and the latency distribution of allocations, which now compete with frees of other threads.
+ */
+
+typedef struct pc_item_s { void* ptr; size_t size; } pc_item_s;
+
+typedef struct pc_queue_s
+{
+    pc_item_s* data;
+    size_t depth;
+    size_t begin;
+    size_t size;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+} pc_queue_s;
+
+static void pc_queue_s_push( pc_queue_s* o, pc_item_s item )
+{
+    pthread_mutex_lock( &o->mutex );
+    while( o->size == o->depth ) pthread_cond_wait( &o->not_full, &o->mutex );
+    o->data[ ( o->begin + o->size ) % o->depth ] = item;
+    o->size++;
+    pthread_cond_signal( &o->not_empty );
+    pthread_mutex_unlock( &o->mutex );
+}
+
+static pc_item_s pc_queue_s_pop( pc_queue_s* o )
+{
+    pthread_mutex_lock( &o->mutex );
+    while( o->size == 0 ) pthread_cond_wait( &o->not_empty, &o->mutex );
+    pc_item_s item = o->data[ o->begin ];
+    o->begin = ( o->begin + 1 ) % o->depth;
+    o->size--;
+    pthread_cond_signal( &o->not_full );
+    pthread_mutex_unlock( &o->mutex );
+    return item;
+}
+
+typedef struct pc_thread_arg_s
+{
+    pc_queue_s* queue;
+    fp_alloc alloc;
+    size_t items;
+    uint32_t seed;
+    double* latency; // ns per allocation (producer)
+} pc_thread_arg_s;
+
+static void* pc_producer_func( void* arg )
+{
+    pc_thread_arg_s* o = arg;
+    uint32_t rval = o->seed;
+    for( size_t i = 0; i < o->items; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t size = 8 + ( rval & 1023 );
+        double time = wall_time();
+        void* ptr = o->alloc( NULL, 0, size, NULL );
+        o->latency[ i ] = ( wall_time() - time ) * 1E9;
+        *( uint8_t* )ptr = 1;
+        pc_queue_s_push( o->queue, ( pc_item_s ){ .ptr = ptr, .size = size } );
+    }
+    return NULL;
+}
+
+static void* pc_consumer_func( void* arg )
+{
+    pc_thread_arg_s* o = arg;
+    for( pc_item_s item = pc_queue_s_pop( o->queue ); item.ptr; item = pc_queue_s_pop( o->queue ) )
+    {
+        o->alloc( item.ptr, item.size, 0, NULL );
+    }
+    return NULL;
+}
+
+static int compare_double( const void* a, const void* b )
+{
+    double va = *( const double* )a;
+    double vb = *( const double* )b;
+    return ( va > vb ) - ( va < vb );
+}
+
+static void producer_consumer_run( const char* name, fp_alloc alloc, size_t producers, size_t consumers, size_t depth, size_t items )
+{
+    pthread_t thread_arr[ 64 ];
+    pc_thread_arg_s arg_arr[ 64 ];
+    ASSERT( producers + consumers <= 64 );
+
+    pc_queue_s queue = { .data = malloc( depth * sizeof( pc_item_s ) ), .depth = depth };
+    pthread_mutex_init( &queue.mutex, NULL );
+    pthread_cond_init( &queue.not_full, NULL );
+    pthread_cond_init( &queue.not_empty, NULL );
+    double* latency = malloc( producers * items * sizeof( double ) );
+
+    double time = wall_time();
+    for( size_t i = 0; i < producers + consumers; i++ )
+    {
+        arg_arr[ i ] = ( pc_thread_arg_s ){ .queue = &queue, .alloc = alloc, .items = items, .seed = 1237 + i, .latency = ( i < producers ) ? latency + i * items : NULL };
+        pthread_create( &thread_arr[ i ], NULL, ( i < producers ) ? pc_producer_func : pc_consumer_func, &arg_arr[ i ] );
+    }
+    for( size_t i = 0; i < producers; i++ ) pthread_join( thread_arr[ i ], NULL );
+    for( size_t i = 0; i < consumers; i++ ) pc_queue_s_push( &queue, ( pc_item_s ){ .ptr = NULL } ); // termination
+    for( size_t i = producers; i < producers + consumers; i++ ) pthread_join( thread_arr[ i ], NULL );
+    time = wall_time() - time;
+
+    size_t n = producers * items;
+    qsort( latency, n, sizeof( double ), compare_double );
+
+    printf
+    (
+        "%s depth %5zu: %6.2f Mitems/s, alloc latency p50 %6.0fns, p99 %7.0fns, p99.9 %8.0fns, max %9.0fns\n",
+        name,
+        depth,
+        n / ( time * 1E6 ),
+        latency[ n / 2 ],
+        latency[ ( n * 99 ) / 100 ],
+        latency[ ( n * 999 ) / 1000 ],
+        latency[ n - 1 ]
+    );
+
+    free( latency );
+    pthread_cond_destroy( &queue.not_empty );
+    pthread_cond_destroy( &queue.not_full );
+    pthread_mutex_destroy( &queue.mutex );
+    free( queue.data );
+}
+
+static void producer_consumer_challenge( size_t producers, size_t consumers, size_t items )
+{
+    size_t depth_arr[] = { 16, 256, 4096 };
+    for( size_t i = 0; i < sizeof( depth_arr ) / sizeof( size_t ); i++ )
+    {
+        size_t depth = depth_arr[ i ];
+        producer_consumer_run( "stdlib            ", external_nalloc,              producers, consumers, depth, items );
+        if( default_unlocked() ) continue; // global manager is not thread-safe
+        producer_consumer_run( "tbman_malloc/free ", tbman_nalloc_no_current_bytes, producers, consumers, depth, items );
+        producer_consumer_run( "tbman_nalloc      ", tbman_nalloc,                 producers, consumers, depth, items );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Memory footprint: Tracks resident memory (RSS), tbman_s_total_space and live requested bytes while running
+ *  adversarial patterns. Each pattern runs in a separate process per manager so that RSS is not skewed by earlier runs.
+ *  Overhead ratio: memory held / live requested bytes. Peak: at the moment of maximum live bytes.
+ *  Steady: at the end of the pattern, after the phase change.
+ */
+
+/// resident set size in bytes (0 if unavailable)
+static size_t resident_size( void )
+{
+#ifdef __linux__
+    size_t pages = 0, resident = 0;
+    FILE* file = fopen( "/proc/self/statm", "r" );
+    if( !file ) return 0;
+    if( fscanf( file, "%zu %zu", &pages, &resident ) != 2 ) resident = 0;
+    fclose( file );
+    return resident * sysconf( _SC_PAGESIZE );
+#else
+    return 0;
+#endif
+}
+
+typedef struct footprint_s
+{
+    tbman_s* man;       // NULL: stdlib
+    size_t base_rss;
+    size_t live;        // live requested bytes
+    size_t peak_live;
+    size_t peak_rss;    // rss above base_rss at peak_live
+    size_t peak_space;  // tbman_s_total_space at peak_live
+} footprint_s;
+
+static void* footprint_s_alloc( footprint_s* o, void* ptr, size_t current_size, size_t requested_size )
+{
+    o->live += requested_size;
+    o->live -= current_size;
+    ptr = o->man ? tbman_s_nalloc( o->man, ptr, current_size, requested_size, NULL ) : external_nalloc( ptr, current_size, requested_size, NULL );
+    if( requested_size > current_size ) memset( ( uint8_t* )ptr + current_size, 1, requested_size - current_size ); // pages count when touched
+    return ptr;
+}
+
+static void footprint_s_sample( footprint_s* o )
+{
+    if( o->live < o->peak_live ) return;
+    o->peak_live  = o->live;
+    o->peak_rss   = resident_size() - o->base_rss;
+    o->peak_space = o->man ? tbman_s_total_space( o->man ) : 0;
+}
+
+/// alloc many blocks, then free every other block
+static void footprint_every_other( footprint_s* o, size_t n )
+{
+    void** ptr_arr = calloc( n, sizeof( void* ) );
+    size_t* size_arr = calloc( n, sizeof( size_t ) );
+    uint32_t rval = 1237;
+    for( size_t i = 0; i < n; i++ )
+    {
+        size_arr[ i ] = 16 + ( ( rval = xsg_u2( rval ) ) & 1023 );
+        ptr_arr[ i ] = footprint_s_alloc( o, NULL, 0, size_arr[ i ] );
+        if( ( i & 1023 ) == 0 ) footprint_s_sample( o );
+    }
+    footprint_s_sample( o );
+    for( size_t i = 0; i < n; i += 2 ) ptr_arr[ i ] = footprint_s_alloc( o, ptr_arr[ i ], size_arr[ i ], 0 );
+}
+
+/// repeated teeth: allocate with growing sizes, then free all but every 16th block
+static void footprint_sawtooth( footprint_s* o, size_t n )
+{
+    size_t teeth = 8;
+    size_t tooth = n / teeth;
+    void** ptr_arr = calloc( n, sizeof( void* ) );
+    size_t* size_arr = calloc( n, sizeof( size_t ) );
+    for( size_t t = 0; t < teeth; t++ )
+    {
+        for( size_t i = 0; i < tooth; i++ )
+        {
+            size_t idx = t * tooth + i;
+            size_arr[ idx ] = 16 + ( i * 4080 ) / tooth;
+            ptr_arr[ idx ] = footprint_s_alloc( o, NULL, 0, size_arr[ idx ] );
+            if( ( i & 1023 ) == 0 ) footprint_s_sample( o );
+        }
+        footprint_s_sample( o );
+        for( size_t i = 0; i < tooth; i++ )
+        {
+            size_t idx = t * tooth + i;
+            if( ( i & 15 ) != 0 ) ptr_arr[ idx ] = footprint_s_alloc( o, ptr_arr[ idx ], size_arr[ idx ], 0 );
+        }
+    }
+}
+
+/// moves all blocks through size classes via realloc: 32 -> 256 -> 2048 -> 64
+static void footprint_class_migration( footprint_s* o, size_t n )
+{
+    size_t size_arr[] = { 32, 256, 2048, 64 };
+    void** ptr_arr = calloc( n, sizeof( void* ) );
+    size_t size = 0;
+    for( size_t k = 0; k < sizeof( size_arr ) / sizeof( size_t ); k++ )
+    {
+        for( size_t i = 0; i < n; i++ )
+        {
+            ptr_arr[ i ] = footprint_s_alloc( o, ptr_arr[ i ], size, size_arr[ k ] );
+            if( ( i & 1023 ) == 0 ) footprint_s_sample( o );
+        }
+        size = size_arr[ k ];
+        footprint_s_sample( o );
+    }
+}
+
+/// runs a pattern in a child process; the instances remain allocated until the process exits
+static void footprint_run( const char* name, void (*pattern)( footprint_s* o, size_t n ), bool tbman, size_t n )
+{
+    fflush( stdout );
+    pid_t pid = fork();
+    if( pid < 0 ) eval_err( "fork failed" );
+    if( pid > 0 )
+    {
+        int status = 0;
+        waitpid( pid, &status, 0 );
+        ASSERT( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+        return;
+    }
+
+    footprint_s o = { .man = tbman ? tbman_s_open() : NULL };
+    o.base_rss = resident_size();
+    pattern( &o, n );
+
+    size_t steady_rss = resident_size() - o.base_rss;
+    double live = o.live > 0 ? o.live : 1;
+    if( tbman )
+    {
+        size_t steady_space = tbman_s_total_space( o.man );
+        printf
+        (
+            "%s tbman : live %6.1fMB -> %6.1fMB; rss/live %5.2f -> %5.2f; total_space/live %5.2f -> %5.2f\n",
+            name, o.peak_live * 1E-6, o.live * 1E-6,
+            ( double )o.peak_rss / o.peak_live, steady_rss / live,
+            ( double )o.peak_space / o.peak_live, steady_space / live
+        );
+    }
+    else
+    {
+        printf
+        (
+            "%s stdlib: live %6.1fMB -> %6.1fMB; rss/live %5.2f -> %5.2f\n",
+            name, o.peak_live * 1E-6, o.live * 1E-6,
+            ( double )o.peak_rss / o.peak_live, steady_rss / live
+        );
+    }
+    fflush( stdout );
+    _exit( 0 );
+}
+
+static void footprint_challenge( size_t n )
+{
+    footprint_run( "free every other", footprint_every_other,     false, n );
+    footprint_run( "free every other", footprint_every_other,     true,  n );
+    footprint_run( "sawtooth        ", footprint_sawtooth,        false, n );
+    footprint_run( "sawtooth        ", footprint_sawtooth,        true,  n );
+    footprint_run( "class migration ", footprint_class_migration, false, n );
+    footprint_run( "class migration ", footprint_class_migration, true,  n );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Soak: Alternates phases with different size distributions (log-uniform within a range) and live-set sizes,
+ *  driving the live set towards each phase's target and churning at the target. Records per phase: allocation
+ *  latency, RSS, and pools created/discarded; finally pools created/discarded and churn events per class.
+ *  Pool thrash (pools repeatedly created and discarded) and slow memory return become visible and comparable across
+ *  pool release policies: inline sweeping (adaptive sweep_hysteresis) and the maintenance thread (s. tbman_s_maintenance_start).
+ *  Runs in a separate process per policy (s. footprint_run).
+ */
+
+typedef struct soak_phase_s { const char* name; size_t min_size; size_t max_size; size_t live; } soak_phase_s;
+
+static const soak_phase_s soak_phase_arr[] =
+{
+    { "small ",    8,   128, 200000 },
+    { "large ", 1024, 16384,   4000 },
+    { "mixed ",    8, 16384,  50000 },
+    { "shrink",    8,   128,  10000 },
+};
+
+static void soak_pool_totals( tbman_s* man, size_t* created, size_t* discarded )
+{
+    *created = *discarded = 0;
+    for( size_t i = 0; i < tbman_s_classes( man ); i++ )
+    {
+        tbman_class_stats_s stats = tbman_s_class_stats( man, i );
+        *created += stats.pools_created;
+        *discarded += stats.pools_discarded;
+    }
+}
+
+static void soak_run( const char* name, size_t maintenance_reserve, size_t rounds, size_t ops )
+{
+    fflush( stdout );
+    pid_t pid = fork();
+    if( pid < 0 ) eval_err( "fork failed" );
+    if( pid > 0 )
+    {
+        int status = 0;
+        waitpid( pid, &status, 0 );
+        ASSERT( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+        return;
+    }
+
+    printf( "%s:\n", name );
+    tbman_s* man = ( maintenance_reserve > 0 ) ? tbman_s_open_locked() : tbman_s_open();
+    if( maintenance_reserve > 0 ) tbman_s_maintenance_start( man, maintenance_reserve, 1000 );
+
+    size_t phases = sizeof( soak_phase_arr ) / sizeof( soak_phase_s );
+    size_t table_size = 0;
+    for( size_t i = 0; i < phases; i++ ) table_size = soak_phase_arr[ i ].live > table_size ? soak_phase_arr[ i ].live : table_size;
+
+    void**  data_table = calloc( table_size, sizeof( void* ) );
+    size_t* size_table = calloc( table_size, sizeof( size_t ) );
+    size_t* live_arr   = malloc( table_size * sizeof( size_t ) ); // occupied slots
+    size_t* free_arr   = malloc( table_size * sizeof( size_t ) ); // empty slots
+    size_t live = 0;
+    size_t empty = table_size;
+    for( size_t i = 0; i < table_size; i++ ) free_arr[ i ] = table_size - 1 - i;
+
+    latency_histogram_s* hist = malloc( sizeof( latency_histogram_s ) );
+    size_t base_rss = resident_size();
+    uint32_t rval = 1237;
+
+    for( size_t r = 0; r < rounds; r++ )
+    {
+        for( size_t p = 0; p < phases; p++ )
+        {
+            const soak_phase_s* phase = &soak_phase_arr[ p ];
+            size_t created0, discarded0;
+            soak_pool_totals( man, &created0, &discarded0 );
+            memset( hist, 0, sizeof( *hist ) );
+
+            for( size_t i = 0; i < ops; i++ )
+            {
+                if( live >= phase->live || ( live > 0 && ( ( rval = xsg_u2( rval ) ) & 1 ) && live * 2 > phase->live ) )
+                {
+                    // free a random live instance
+                    size_t k = ( rval = xsg_u2( rval ) ) % live;
+                    size_t idx = live_arr[ k ];
+                    live_arr[ k ] = live_arr[ --live ];
+                    free_arr[ empty++ ] = idx;
+                    tbman_s_nfree( man, data_table[ idx ], size_table[ idx ] );
+                    data_table[ idx ] = NULL;
+                }
+                if( live < phase->live )
+                {
+                    size_t idx = free_arr[ --empty ];
+                    live_arr[ live++ ] = idx;
+                    rval = xsg_u2( rval );
+                    size_table[ idx ] = phase->min_size * pow( ( double )phase->max_size / phase->min_size, rval * pow( 2.0, -32 ) );
+                    uint64_t time = cycle_count();
+                    data_table[ idx ] = tbman_s_alloc( man, NULL, size_table[ idx ], NULL );
+                    latency_histogram_s_add( hist, cycle_count() - time );
+                    *( uint8_t* )data_table[ idx ] = 1;
+                }
+            }
+
+            size_t created1, discarded1;
+            soak_pool_totals( man, &created1, &discarded1 );
+            printf
+            (
+                "  round %zu %s: live %6zu, rss %7.1fMB, pools +%5zu -%5zu, alloc p50 %5.0fns, p99 %6.0fns, p999 %7.0fns, max %8.0fns\n",
+                r, phase->name, live, ( resident_size() - base_rss ) * 1E-6, created1 - created0, discarded1 - discarded0,
+                latency_histogram_s_quantile( hist, 0.5 ),
+                latency_histogram_s_quantile( hist, 0.99 ),
+                latency_histogram_s_quantile( hist, 0.999 ),
+                hist->max * cycle_ns()
+            );
+        }
+    }
+
+    printf( "  pools created/discarded (churn events) per class:" );
+    for( size_t i = 0, column = 0; i < tbman_s_classes( man ); i++ )
+    {
+        tbman_class_stats_s stats = tbman_s_class_stats( man, i );
+        if( stats.pools_created == 0 ) continue;
+        printf( "%s%6zu: %5zu/%5zu (%4zu)", ( column++ % 5 ) == 0 ? "\n   " : "  ", stats.block_size, stats.pools_created, stats.pools_discarded, stats.churn_events );
+    }
+    printf( "\n" );
+
+    for( size_t i = 0; i < live; i++ ) tbman_s_nfree( man, data_table[ live_arr[ i ] ], size_table[ live_arr[ i ] ] );
+    tbman_s_discard( man );
+
+    free( hist );
+    free( free_arr );
+    free( live_arr );
+    free( size_table );
+    free( data_table );
+    fflush( stdout );
+    _exit( 0 );
+}
+
+static void soak_challenge( size_t rounds, size_t ops )
+{
+    soak_run( "inline sweeping (adaptive sweep_hysteresis)", 0, rounds, ops );
+    soak_run( "maintenance thread (reserve 2 pools)", 2, rounds, ops );
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Batch allocation: Compares n single allocations with one batch allocation (speed and integrity) */
+
+static void alloc_batch_challenge( size_t size, size_t n )
+{
+    tbman_s* man = tbman_s_open();
+    void** ptrs = malloc( sizeof( void* ) * n );
+
+    for( size_t run = 0; run < 2; run++ )
+    {
+        clock_t time = clock();
+        size_t granted = 0;
+        if( run == 0 )
+        {
+            for( size_t i = 0; i < n; i++ ) ptrs[ i ] = tbman_s_alloc( man, NULL, size, &granted );
+        }
+        else
+        {
+            granted = tbman_s_alloc_batch( man, size, n, ptrs );
+        }
+        time = clock() - time;
+
+        ASSERT( granted == tbman_s_good_size( man, size, NULL ) );
+        for( size_t i = 0; i < n; i++ ) *( size_t* )ptrs[ i ] = i;
+        for( size_t i = 0; i < n; i++ ) ASSERT( *( size_t* )ptrs[ i ] == i );
+        ASSERT( tbman_s_total_instances( man ) == n );
+
+        size_t ns = ( 1E9 * time ) / ( CLOCKS_PER_SEC * n );
+        printf( "%s (size %zu): %6zuns per instance\n", run == 0 ? "single alloc" : "batch alloc ", size, ns );
+
+        for( size_t i = 0; i < n; i++ ) tbman_s_nfree( man, ptrs[ i ], size );
+        ASSERT( tbman_s_total_instances( man ) == 0 );
+    }
+
+    free( ptrs );
+    tbman_s_close( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Batch free: Compares n single frees in random order with one batch free (speed and integrity) */
+
+static void free_batch_challenge( size_t max_size, size_t n, bool sized )
+{
+    tbman_s* man = tbman_s_open();
+    void** ptrs = malloc( sizeof( void* ) * n );
+    size_t* sizes = malloc( sizeof( size_t ) * n );
+
+    for( size_t run = 0; run < 2; run++ )
+    {
+        uint32_t rval = 1234;
+        for( size_t i = 0; i < n; i++ )
+        {
+            rval = xsg_u2( rval );
+            sizes[ i ] = 1 + rval % max_size;
+            ptrs[ i ] = tbman_s_alloc( man, NULL, sizes[ i ], NULL );
+        }
+
+        // teardown in random order
+        for( size_t i = n - 1; i > 0; i-- )
+        {
+            rval = xsg_u2( rval );
+            size_t j = rval % ( i + 1 );
+            void* p = ptrs[ i ]; ptrs[ i ] = ptrs[ j ]; ptrs[ j ] = p;
+            size_t s = sizes[ i ]; sizes[ i ] = sizes[ j ]; sizes[ j ] = s;
+        }
+
+        clock_t time = clock();
+        if( run == 0 )
+        {
+            if( sized )
+            {
+                for( size_t i = 0; i < n; i++ ) tbman_s_nfree( man, ptrs[ i ], sizes[ i ] );
+            }
+            else
+            {
+                for( size_t i = 0; i < n; i++ ) tbman_s_free( man, ptrs[ i ] );
+            }
+        }
+        else
+        {
+            tbman_s_free_batch( man, ptrs, sized ? sizes : NULL, n );
+        }
+        time = clock() - time;
+        ASSERT( tbman_s_total_instances( man ) == 0 );
+        ASSERT( tbman_s_check_consistency( man ) );
+
+        size_t ns = ( 1E9 * time ) / ( CLOCKS_PER_SEC * n );
+        printf( "%s (%s): %6zuns per instance\n", run == 0 ? "single free" : "batch free ", sized ? "sized  " : "unsized", ns );
+    }
+
+    free( sizes );
+    free( ptrs );
+    tbman_s_close( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Realloc growth: Grows many dynamic arrays (or strings) element by element in round-robin order.
+ *  A buffer is reallocated only when its capacity is exhausted; the capacity is the granted size, hence
+ *  tbman skips reallocs whenever it grants more than requested.
+ *  growth: 0: request one more element; 2: request twice the capacity
+ *  Counts reallocs, copies (instance moved) with bytes copied, and reallocs crossing max_block_size into the
+ *  external path (tbman_good_size).
+ */
+static void growth_run( const char* name, fp_alloc alloc, size_t buffers, size_t elem_size, size_t max_elems, size_t growth )
+{
+    uint8_t** data = calloc( buffers, sizeof( uint8_t* ) );
+    size_t* size   = calloc( buffers, sizeof( size_t ) ); // used bytes
+    size_t* space  = calloc( buffers, sizeof( size_t ) ); // capacity (granted bytes)
+    size_t* limit  = calloc( buffers, sizeof( size_t ) ); // final number of elements
+
+    uint32_t rval = 1237;
+    size_t total_elems = 0;
+    for( size_t i = 0; i < buffers; i++ )
+    {
+        limit[ i ] = 1 + ( rval = xsg_u2( rval ) ) % max_elems;
+        if( total_elems < limit[ i ] ) total_elems = limit[ i ];
+    }
+
+    size_t reallocs = 0;
+    size_t copies = 0;
+    size_t copied_bytes = 0;
+    size_t crossings = 0;
+
+    uint64_t time = cycle_count();
+    for( size_t e = 0; e < total_elems; e++ )
+    {
+        for( size_t i = 0; i < buffers; i++ )
+        {
+            if( e >= limit[ i ] ) continue;
+            if( size[ i ] + elem_size > space[ i ] )
+            {
+                size_t request = ( growth > 0 && space[ i ] > 0 ) ? space[ i ] * growth : size[ i ] + elem_size;
+                size_t old_class = 0, new_class = 0;
+                tbman_good_size( space[ i ] > 0 ? space[ i ] : 1, &old_class );
+                tbman_good_size( request, &new_class );
+                crossings += ( old_class != TBMAN_CLASS_EXTERNAL && new_class == TBMAN_CLASS_EXTERNAL );
+
+                uint8_t* ptr = alloc( data[ i ], space[ i ], request, &space[ i ] );
+                reallocs++;
+                if( data[ i ] && ptr != data[ i ] )
+                {
+                    copies++;
+                    copied_bytes += size[ i ];
+                }
+                data[ i ] = ptr;
+            }
+            for( size_t k = 0; k < elem_size; k++ ) data[ i ][ size[ i ] + k ] = ( i + size[ i ] + k ) & 255;
+            size[ i ] += elem_size;
+        }
+    }
+    time = cycle_count() - time;
+
+    for( size_t i = 0; i < buffers; i++ )
+    {
+        ASSERT( size[ i ] == limit[ i ] * elem_size );
+        for( size_t k = 0; k < size[ i ]; k++ ) ASSERT( data[ i ][ k ] == ( ( i + k ) & 255 ) );
+        data[ i ] = alloc( data[ i ], space[ i ], 0, NULL );
+    }
+
+    printf
+    (
+        "%s: %8.2fms, reallocs %8zu, copies %8zu, copied %8.1fMB, external crossings %6zu\n",
+        name, time * cycle_ns() * 1E-6, reallocs, copies, copied_bytes * 1E-6, crossings
+    );
+
+    free( limit );
+    free( space );
+    free( size );
+    free( data );
+}
+
+static void growth_challenge( void )
+{
+    // dynamic arrays of 8 byte elements (up to 64KB); strings of 1 byte characters (up to 32KB)
+    size_t elem_size_arr[] = { 8, 1 };
+    size_t max_elems_arr[] = { 8192, 32768 };
+    const char* scenario_arr[] = { "arrays ", "strings" };
+    size_t buffers = 250;
+    for( size_t s = 0; s < 2; s++ )
+    {
+        for( size_t growth = 0; growth <= 2; growth += 2 )
+        {
+            char name[ 64 ];
+            const char* policy = growth > 0 ? "doubling" : "exact   ";
+            snprintf( name, sizeof( name ), "%s %s stdlib       ", scenario_arr[ s ], policy );
+            growth_run( name, external_nalloc,               buffers, elem_size_arr[ s ], max_elems_arr[ s ], growth );
+            snprintf( name, sizeof( name ), "%s %s tbman_alloc  ", scenario_arr[ s ], policy );
+            growth_run( name, tbman_nalloc_no_current_bytes, buffers, elem_size_arr[ s ], max_elems_arr[ s ], growth );
+            snprintf( name, sizeof( name ), "%s %s tbman_nalloc ", scenario_arr[ s ], policy );
+            growth_run( name, tbman_nalloc,                  buffers, elem_size_arr[ s ], max_elems_arr[ s ], growth );
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of size class query */
+
+static void tbman_s_good_size_test( void )
+{
+    tbman_s* man = tbman_s_open();
+    size_t last_class = 0;
+    for( size_t size = 1; size < 40000; size += 1 + size / 16 )
+    {
+        size_t class_index = 0;
+        size_t good_size = tbman_s_good_size( man, size, &class_index );
+        size_t granted = 0;
+        void* data = tbman_s_alloc( man, NULL, size, &granted );
+        ASSERT( good_size == granted && good_size >= size );
+        ASSERT( tbman_s_good_size( man, good_size, NULL ) == good_size );
+        if( class_index == TBMAN_CLASS_EXTERNAL )
+        {
+            ASSERT( good_size == size );
+        }
+        else
+        {
+            ASSERT( class_index >= last_class );
+            last_class = class_index;
+        }
+        tbman_s_free( man, data );
+    }
+    ASSERT( last_class > 0 );
+    tbman_s_close( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of adaptive sweeping: a class oscillating around a pool boundary raises its retention; draining relaxes it */
+
+static void tbman_s_sweep_adapt_test( void )
+{
+    tbman_s* man = tbman_s_open();
+    size_t class_index = 0;
+    size_t size = tbman_s_good_size( man, 4096, &class_index );
+    ASSERT( class_index != TBMAN_CLASS_EXTERNAL );
+
+    // oscillation: without adaptation, each cycle would create and discard a pool
+    for( size_t i = 0; i < 1000; i++ ) tbman_s_free( man, tbman_s_malloc( man, size ) );
+    tbman_class_stats_s stats = tbman_s_class_stats( man, class_index );
+    ASSERT( stats.churn_events > 0 );
+    ASSERT( stats.sweep_reserve > 0 );
+    ASSERT( stats.pools_created < 10 );
+    ASSERT( stats.instances == 0 );
+
+    // draining many pools without re-creating them relaxes retention to the default
+    void* ptr_arr[ 1000 ];
+    for( size_t i = 0; i < 1000; i++ ) ptr_arr[ i ] = tbman_s_malloc( man, size );
+    for( size_t i = 0; i < 1000; i++ ) tbman_s_free( man, ptr_arr[ i ] );
+    stats = tbman_s_class_stats( man, class_index );
+    ASSERT( stats.sweep_reserve == 0 );
+    ASSERT( stats.sweep_hysteresis == tbman_s_class_stats( man, 0 ).sweep_hysteresis ); // unused class 0: default
+    ASSERT( stats.pools == 0 );
+
+    ASSERT( tbman_s_check_consistency( man ) );
+    tbman_s_close( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of background maintenance (pool provisioning and release) */
+
+/// Waits until the maintenance thread completed 'passes' further passes; returns the statistics
+static tbman_maintenance_stats_s maintenance_wait( tbman_s* man, size_t passes )
+{
+    tbman_maintenance_stats_s stats = tbman_s_maintenance_stats( man );
+    size_t target = stats.passes + passes;
+    clock_t time = clock();
+    while( stats.passes < target )
+    {
+        if( clock() - time > CLOCKS_PER_SEC * 10 ) eval_err( "Maintenance thread is not progressing." );
+        stats = tbman_s_maintenance_stats( man );
+    }
+    return stats;
+}
+
+static void tbman_s_maintenance_test( void )
+{
+    tbman_s* man = tbman_s_open_locked();
+    size_t reserve_pools = 2;
+    size_t block_size = 64;
+    tbman_s_maintenance_start( man, reserve_pools, 1000 );
+
+    // first pool is created inline; the reserve of the class follows
+    void* first = tbman_s_alloc( man, NULL, block_size, NULL );
+    tbman_maintenance_stats_s stats = maintenance_wait( man, 2 );
+    ASSERT( stats.pools_inline == 1 );
+    ASSERT( stats.pools_provisioned == reserve_pools );
+
+    // allocations drawing from the reserve create no pools inline
+    size_t n = 1000;
+    void** data = malloc( sizeof( void* ) * n );
+    for( size_t i = 0; i < n; i++ ) data[ i ] = tbman_s_alloc( man, NULL, block_size, NULL );
+    ASSERT( tbman_s_maintenance_stats( man ).pools_inline == 1 );
+    stats = maintenance_wait( man, 2 );
+    ASSERT( stats.pools_provisioned > reserve_pools );
+
+    // freeing releases no pools inline; surplus pools are released by the maintenance thread
+    for( size_t i = 0; i < n; i++ ) tbman_s_free( man, data[ i ] );
+    stats = maintenance_wait( man, 2 );
+    ASSERT( stats.pools_released > 0 );
+    ASSERT( tbman_s_check_consistency( man ) );
+
+    // unused classes retain no pools
+    tbman_s_free( man, first );
+    stats = maintenance_wait( man, 3 );
+    ASSERT( stats.pools_released == stats.pools_provisioned + stats.pools_inline );
+    tbman_s_maintenance_stop( man );
+    ASSERT( tbman_s_check_consistency( man ) );
+
+    /* A class used since the last pass keeps its reserve when more than one batch of empty pools is released.
+     * The pass following the first one comes after the interval, when all instances are freed again.
+     */
+    size_t class_index = 0;
+    tbman_s_good_size( man, block_size, &class_index );
+    n = 24 * 0x10000 / block_size; // 24 pools (default pool size)
+    data = realloc( data, sizeof( void* ) * n );
+    tbman_s_maintenance_start( man, reserve_pools, 500000 );
+    maintenance_wait( man, 1 );
+    for( size_t i = 0; i < n; i++ ) data[ i ] = tbman_s_alloc( man, NULL, block_size, NULL );
+    for( size_t i = 0; i < n; i++ ) tbman_s_free( man, data[ i ] );
+    ASSERT( tbman_s_class_stats( man, class_index ).pools > reserve_pools + 16 );
+    maintenance_wait( man, 1 );
+    ASSERT( tbman_s_class_stats( man, class_index ).pools == reserve_pools );
+    tbman_s_maintenance_stop( man );
+
+    free( data );
+    tbman_s_discard( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of deferred freeing */
+
+static void tbman_s_free_deferred_test( void )
+{
+    tbman_s* man = tbman_s_open_locked();
+    size_t n = 1000;
+    void** data = malloc( sizeof( void* ) * n );
+    size_t* size = malloc( sizeof( size_t ) * n );
+
+    // explicit flush; sizes known, unknown and too small to be stored
+    for( size_t i = 0; i < n; i++ )
+    {
+        size[ i ] = ( i % 100 == 0 ) ? 100000 : 8 + ( i * 7 ) % 500;
+        data[ i ] = tbman_s_alloc( man, NULL, size[ i ], NULL );
+    }
+    for( size_t i = 0; i < n; i++ ) tbman_s_free_deferred( man, data[ i ], ( i & 1 ) ? size[ i ] : 0 );
+    ASSERT( tbman_s_total_instances( man ) == n );
+    ASSERT( tbman_s_flush_deferred( man ) == n );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    ASSERT( tbman_s_flush_deferred( man ) == 0 );
+
+    // queuing thread drains at the limit
+    tbman_s_set_deferred_limit( man, 10 );
+    for( size_t i = 0; i < 10; i++ ) data[ i ] = tbman_s_alloc( man, NULL, size[ i ], NULL );
+    for( size_t i = 0; i < 9; i++ ) tbman_s_free_deferred( man, data[ i ], size[ i ] );
+    ASSERT( tbman_s_total_instances( man ) == 10 );
+    tbman_s_free_deferred( man, data[ 9 ], size[ 9 ] );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+
+    // maintenance thread drains
+    tbman_s_maintenance_start( man, 1, 1000 );
+    for( size_t i = 0; i < n; i++ ) data[ i ] = tbman_s_alloc( man, NULL, size[ i ], NULL );
+    for( size_t i = 0; i < n; i++ ) tbman_s_free_deferred( man, data[ i ], size[ i ] );
+    maintenance_wait( man, 2 );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    ASSERT( tbman_s_check_consistency( man ) );
+    tbman_s_maintenance_stop( man );
+
+    // discarding drains
+    tbman_s_free_deferred( man, tbman_s_alloc( man, NULL, 64, NULL ), 64 );
+    free( size );
+    free( data );
+    tbman_s_discard( man );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of in-place expansion */
+
+static void tbman_s_expand_test( void )
+{
+    size_t granted = 0;
+
+    // pooled instance: expansion within the block size only
+    tbman_s* man = tbman_s_open();
+    uint8_t* data = tbman_s_alloc( man, NULL, 100, &granted );
+    ASSERT(  tbman_s_expand( man, data, 100, granted, granted * 2, &granted ) );
+    ASSERT( !tbman_s_expand( man, data, 0, granted + 1, granted * 2, NULL ) );
+    ASSERT( tbman_s_granted_space( man, data ) == granted );
+    tbman_s_free( man, data );
+    tbman_s_discard( man );
+
+    // large instance in a region: absorbs the free neighbor
+    size_t region_size = 1 << 24;
+    void* region = malloc( region_size );
+    man = tbman_s_create_in_region( region, region_size, 0x10000, 8, 1024 * 16, 1, true );
+    uint8_t* prev = tbman_s_alloc( man, NULL, 100000, NULL ); // sets up metadata of large instances
+    data = tbman_s_alloc( man, NULL, 100000, NULL );
+    ASSERT( tbman_s_expand( man, data, 100000, 200000, 400000, &granted ) );
+    ASSERT( granted >= 200000 && tbman_s_granted_space( man, data ) == granted );
+    data[ granted - 1 ] = 1;
+    uint8_t* next = tbman_s_alloc( man, NULL, 100000, NULL );
+    ASSERT( next >= data + granted || next + 100000 <= data );
+    ASSERT( !tbman_s_expand( man, data, granted, region_size, region_size, NULL ) );
+    ASSERT( tbman_s_check_consistency( man ) );
+    tbman_s_free( man, prev );
+    tbman_s_free( man, next );
+    tbman_s_free( man, data );
+    tbman_s_discard( man );
+    free( region );
+
+    // large instance from mappings: uses page slack or extends the mapping
+    if( tbman_provider_mmap() )
+    {
+        tbman_params_s params;
+        tbman_params_s_init( &params );
+        params.provider = tbman_provider_mmap();
+        man = tbman_s_create_with( &params );
+        data = tbman_s_alloc( man, NULL, 100000, NULL );
+        ASSERT( tbman_s_expand( man, data, 100000, 100001, 100001, &granted ) );
+        if( tbman_s_expand( man, data, 0, 1 << 20, 1 << 20, &granted ) ) data[ granted - 1 ] = 1;
+        tbman_s_free( man, data );
+        tbman_s_discard( man );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of manager inside a memory region */
+
+static void tbman_s_region_test( void )
+{
+    size_t region_size = 1 << 26;
+    void* region = malloc( region_size );
+    tbman_s* man = tbman_s_create_in_region( region, region_size, 0x10000, 8, 1024 * 16, 1, true );
+    ASSERT( ( void* )man >= region && ( uint8_t* )man < ( uint8_t* )region + region_size );
+    ASSERT( tbman_s_attach_region( region ) == man );
+
+    void* ptr_arr[ 1000 ];
+    uint32_t rval = 1234;
+    for( size_t i = 0; i < 1000; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t size = 1 + rval % 40000;
+        uint8_t* data = tbman_s_alloc( man, NULL, size, NULL );
+        ASSERT( data >= ( uint8_t* )region && data + size <= ( uint8_t* )region + region_size );
+        data[ 0 ] = data[ size - 1 ] = 1;
+        ptr_arr[ i ] = data;
+    }
+    ASSERT( tbman_s_total_instances( man ) == 1000 );
+
+    for( size_t i = 0; i < 1000; i += 2 ) ptr_arr[ i ] = tbman_s_realloc( man, ptr_arr[ i ], 100 );
+    for( size_t i = 0; i < 1000; i++ ) tbman_s_free( man, ptr_arr[ i ] );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+
+    tbman_s_discard( man );
+    free( region );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of persistent manager (file backed) */
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+
+typedef struct persistent_list_s { struct persistent_list_s* next; size_t value; } persistent_list_s;
+
+static void tbman_s_persistent_test( void )
+{
+    const char* path = "tbman_eval_heap.tmp";
+    remove( path );
+
+    tbman_s* man = tbman_s_open_file( path, 1 << 24, 0x10000, 8, 1024 * 16, 1, true );
+    ASSERT( man );
+    persistent_list_s* list = NULL;
+    for( size_t i = 0; i < 1000; i++ )
+    {
+        persistent_list_s* node = tbman_s_alloc( man, NULL, sizeof( persistent_list_s ), NULL );
+        node->next = list;
+        node->value = i;
+        list = node;
+    }
+    tbman_s_set_root( man, list );
+    tbman_s_close_file( man );
+
+    man = tbman_s_open_file( path, 0, 0, 0, 0, 0, false );
+    ASSERT( man );
+    ASSERT( tbman_s_check_consistency( man ) );
+    ASSERT( tbman_s_total_instances( man ) == 1000 );
+    list = tbman_s_root( man );
+    for( size_t i = 1000; i > 0; i-- )
+    {
+        ASSERT( list->value == i - 1 );
+        persistent_list_s* next = list->next;
+        tbman_s_free( man, list );
+        list = next;
+    }
+    ASSERT( list == NULL );
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_s_close_file( man );
+
+    remove( path );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of a region shared between processes.
+ *  The second process runs this program as a new image (fork + exec), hence its function addresses differ from the
+ *  first process under ASLR/PIE. Both processes use the manager inside the region alternately.
+ */
+
+/// pushes count nodes with values first ... first + count - 1; returns the new list
+static persistent_list_s* persistent_list_push( tbman_s* man, persistent_list_s* list, size_t first, size_t count )
+{
+    for( size_t i = first; i < first + count; i++ )
+    {
+        persistent_list_s* node = tbman_s_alloc( man, NULL, sizeof( persistent_list_s ), NULL );
+        node->next = list;
+        node->value = i;
+        list = node;
+    }
+    return list;
+}
+
+/// true when list holds values count - 1 ... 0
+static bool persistent_list_verify( const persistent_list_s* list, size_t count )
+{
+    for( size_t i = count; i > 0; i--, list = list->next ) if( !list || list->value != i - 1 ) return false;
+    return list == NULL;
+}
+
+/// random alloc, realloc and free of pooled and external instances (creates and discards pools); leaves no instance
+static void shared_churn( tbman_s* man, uint32_t seed, size_t cycles )
+{
+    void* ptr_arr[ 256 ] = { NULL };
+    uint32_t rval = seed;
+    for( size_t i = 0; i < cycles; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval & 255;
+        size_t size = 1 + ( rval >> 8 ) % 40000;
+        ptr_arr[ idx ] = tbman_s_alloc( man, ptr_arr[ idx ], ( rval & 0x100 ) ? size : 0, NULL );
+    }
+    for( size_t i = 0; i < 256; i++ ) tbman_s_free( man, ptr_arr[ i ] );
+}
+
+#ifdef __linux__
+
+/// starts this program in a new process with the given arguments (argv[ 0 ] ignored); returns its pid
+static pid_t eval_spawn_start( char** argv )
+{
+    fflush( stdout );
+    pid_t pid = fork();
+    if( pid == 0 )
+    {
+        execv( "/proc/self/exe", argv );
+        _exit( 127 );
+    }
+    return pid;
+}
+
+/// waits for a process started by eval_spawn_start; returns the exit status (-1: terminated by a signal)
+static int eval_spawn_wait( pid_t pid )
+{
+    int status = 0;
+    if( pid < 0 || waitpid( pid, &status, 0 ) != pid ) return -1;
+    return WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+}
+
+/// runs this program in a new process with the given arguments (argv[ 0 ] ignored); returns the exit status
+static int eval_spawn( char** argv )
+{
+    return eval_spawn_wait( eval_spawn_start( argv ) );
+}
+
+/// second process of tbman_s_region_shared_test; returns 0 on success
+static int region_shared_child( const char* path, void* base, size_t size )
+{
+    int fd = open( path, O_RDWR );
+    if( fd < 0 ) return 1;
+    void* addr = mmap( base, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( addr != base ) return 2;
+
+    tbman_s* man = tbman_s_attach_region( base );
+    persistent_list_s* list = tbman_s_root( man );
+    if( !persistent_list_verify( list, 1000 ) ) return 3;
+    shared_churn( man, 4321, 20000 );
+    tbman_s_set_root( man, persistent_list_push( man, list, 1000, 1000 ) );
+    if( !tbman_s_check_consistency( man ) ) return 4;
+    munmap( base, size );
+    return 0;
+}
+
+static void tbman_s_region_shared_test( void )
+{
+    const char* path = "tbman_eval_region.tmp";
+    size_t size = 1 << 26;
+    remove( path );
+    int fd = open( path, O_RDWR | O_CREAT, 0600 );
+    ASSERT( fd >= 0 );
+    ASSERT( ftruncate( fd, size ) == 0 );
+    void* base = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    ASSERT( base != MAP_FAILED );
+
+    tbman_s* man = tbman_s_create_in_region( base, size, 0x10000, 8, 1024 * 16, 1, true );
+    shared_churn( man, 1234, 20000 );
+    tbman_s_set_root( man, persistent_list_push( man, NULL, 0, 1000 ) );
+
+    char base_arg[ 32 ], size_arg[ 32 ];
+    snprintf( base_arg, sizeof( base_arg ), "%p", base );
+    snprintf( size_arg, sizeof( size_arg ), "%zu", size );
+    char* argv[] = { "tbman_eval", "child", "region", ( char* )path, base_arg, size_arg, NULL };
+    ASSERT( eval_spawn( argv ) == 0 );
+
+    // the other process must not have altered state of this process
+    shared_churn( man, 5678, 20000 );
+    ASSERT( persistent_list_verify( tbman_s_root( man ), 2000 ) );
+    ASSERT( tbman_s_check_consistency( man ) );
+
+    for( persistent_list_s* list = tbman_s_root( man ); list; )
+    {
+        persistent_list_s* next = list->next;
+        tbman_s_free( man, list );
+        list = next;
+    }
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_s_discard( man );
+    munmap( base, size );
+    remove( path );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+/** Test of a persistent manager opened by several processes.
+ *  A second process opens the file while the first one keeps using it; further processes terminate without
+ *  closing the file, idle or while holding the manager's lock. Reopening releases what they left behind.
+ */
+
+/** second process of tbman_s_persistent_shared_test; returns 0 on success
+ *  mode "use":     opens, verifies the list of 'count' nodes, churns, extends the list by 1000 nodes and closes.
+ *  mode "abandon": like "use" but terminates without closing.
+ *  mode "crash":   like "abandon" but terminates (abort) inside the manager while holding its lock.
+ */
+static int persistent_shared_child( const char* path, const char* mode, size_t count )
+{
+    tbman_s* man = tbman_s_open_file( path, 0, 0, 0, 0, 0, false );
+    if( !man ) return 1;
+    if( tbman_s_file_processes( man ) < 1 ) return 2;
+    persistent_list_s* list = tbman_s_root( man );
+    if( !persistent_list_verify( list, count ) ) return 3;
+    shared_churn( man, 4321, 20000 );
+    tbman_s_set_root( man, persistent_list_push( man, list, count, 1000 ) );
+    if( !tbman_s_check_consistency( man ) ) return 4;
+
+    if( !strcmp( mode, "use" ) )
+    {
+        tbman_s_close_file( man );
+        return 0;
+    }
+
+    if( !strcmp( mode, "crash" ) )
+    {
+        // freeing an invalid address fails with an error (abort) after the manager's lock was acquired
+        struct rlimit no_core = { 0, 0 };
+        setrlimit( RLIMIT_CORE, &no_core );
+        if( !freopen( "/dev/null", "w", stderr ) ) return 5;
+        size_t invalid = 0;
+        tbman_s_free( man, &invalid );
+    }
+
+    _exit( 0 );
+}
+
+static void tbman_s_persistent_shared_test( void )
+{
+    const char* path = "tbman_eval_shared_heap.tmp";
+    remove( path );
+
+    tbman_s* man = tbman_s_open_file( path, 1 << 26, 0x10000, 8, 1024 * 16, 1, true );
+    ASSERT( man );
+    ASSERT( tbman_s_file_processes( man ) == 1 );
+    tbman_s_set_root( man, persistent_list_push( man, NULL, 0, 1000 ) );
+
+    // concurrent use: opening in the second process must not break locks held by this process
+    {
+        char* argv[] = { "tbman_eval", "child", "file", ( char* )path, "use", "1000", NULL };
+        pid_t pid = eval_spawn_start( argv );
+        shared_churn( man, 1234, 20000 );
+        ASSERT( eval_spawn_wait( pid ) == 0 );
+    }
+    ASSERT( tbman_s_file_processes( man ) == 1 );
+    ASSERT( persistent_list_verify( tbman_s_root( man ), 2000 ) );
+    ASSERT( tbman_s_check_consistency( man ) );
+
+    // a process terminating without closing leaves its registration; reopening removes it
+    {
+        char* argv[] = { "tbman_eval", "child", "file", ( char* )path, "abandon", "2000", NULL };
+        ASSERT( eval_spawn( argv ) == 0 );
+    }
+    ASSERT( tbman_s_file_processes( man ) == 2 );
+    shared_churn( man, 5678, 20000 );
+    tbman_s_close_file( man );
+
+    man = tbman_s_open_file( path, 0, 0, 0, 0, 0, false );
+    ASSERT( man );
+    ASSERT( tbman_s_file_processes( man ) == 1 );
+    ASSERT( persistent_list_verify( tbman_s_root( man ), 3000 ) );
+    tbman_s_close_file( man );
+
+    // a process terminating while holding the manager's lock; reopening releases the lock
+    {
+        char* argv[] = { "tbman_eval", "child", "file", ( char* )path, "crash", "3000", NULL };
+        ASSERT( eval_spawn( argv ) == -1 );
+    }
+
+    man = tbman_s_open_file( path, 0, 0, 0, 0, 0, false );
+    ASSERT( man );
+    ASSERT( tbman_s_file_processes( man ) == 1 );
+    ASSERT( persistent_list_verify( tbman_s_root( man ), 4000 ) );
+    shared_churn( man, 8765, 20000 );
+
+    for( persistent_list_s* list = tbman_s_root( man ); list; )
+    {
+        persistent_list_s* next = list->next;
+        tbman_s_free( man, list );
+        list = next;
+    }
+    ASSERT( tbman_s_total_instances( man ) == 0 );
+    tbman_s_close_file( man );
+    remove( path );
+}
+
+/// entry of processes spawned by tests (s. eval_spawn); returns the exit status
+static int eval_child_main( int argc, char** argv )
+{
+    if( argc == 4 && !strcmp( argv[ 0 ], "region" ) )
+    {
+        return region_shared_child( argv[ 1 ], ( void* )( uintptr_t )strtoull( argv[ 2 ], NULL, 16 ), strtoull( argv[ 3 ], NULL, 10 ) );
+    }
+    if( argc == 4 && !strcmp( argv[ 0 ], "file" ) )
+    {
+        return persistent_shared_child( argv[ 1 ], argv[ 2 ], strtoull( argv[ 3 ], NULL, 10 ) );
+    }
+    return 100;
+}
+
+#endif // __linux__
+
+#endif
+
+/**********************************************************************************************************************/
+/** Workload generator.
+ *  A workload is a precomputed stream of operations on a table of instances, hence generating sizes adds no
+ *  overhead to the measurement. Operation { idx, size } on table slot idx:
+ *    - size == 0: free the instance
+ *    - slot empty: allocate size bytes
+ *    - otherwise: reallocate to size bytes
+ *  Distributions:
+ *    loguniform: log-uniform sizes in [min_size, max_size] (as alloc_challenge); alternating alloc/free per slot
+ *    zipf:       size rank k (sizes k * min_size) with probability ~ 1/k; alternating alloc/free per slot
+ *    uniform:    uniform sizes in [min_size, max_size]; alternating alloc/free per slot
+ *    bimodal:    90% small sizes in [min_size, 8 * min_size], 10% large sizes in [max_size / 4, max_size]
+ *    fixed:      all sizes max_size
+ *    growth:     instances start at min_size and grow by factor 1.5 via realloc; freed on exceeding max_size
+ *    lifetime:   90% of operations hit 1/16 of the slots (short-lived instances); sizes log-uniform
+ */
+
+typedef enum workload_dist
+{
+    WORKLOAD_LOGUNIFORM = 0,
+    WORKLOAD_ZIPF,
+    WORKLOAD_UNIFORM,
+    WORKLOAD_BIMODAL,
+    WORKLOAD_FIXED,
+    WORKLOAD_GROWTH,
+    WORKLOAD_LIFETIME,
+    WORKLOAD_DISTS
+} workload_dist;
+
+static const char* workload_dist_name[ WORKLOAD_DISTS ] = { "loguniform", "zipf", "uniform", "bimodal", "fixed", "growth", "lifetime" };
+
+typedef struct workload_params_s
+{
+    workload_dist dist;
+    size_t table_size;
+    size_t ops;
+    size_t min_size;
+    size_t max_size;
+    uint32_t seed;
+} workload_params_s;
+
+typedef struct workload_s
+{
+    size_t table_size;
+    size_t ops;
+    uint32_t* idx;
+    size_t* size;
+} workload_s;
+
+static void workload_params_s_init( workload_params_s* o )
+{
+    o->dist = WORKLOAD_LOGUNIFORM;
+    o->table_size = 100000;
+    o->ops = 1000000;
+    o->min_size = 8;
+    o->max_size = 65536;
+    o->seed = 1237;
+}
+
+/// uniform random value in [0, 1)
+static inline double workload_rand( uint32_t* rval )
+{
+    *rval = xsg_u2( *rval );
+    return *rval * pow( 2.0, -32 );
+}
+
+/// draws an allocation size
+static size_t workload_draw_size( const workload_params_s* p, const double* zipf_cdf, size_t zipf_ranks, uint32_t* rval )
+{
+    size_t range = p->max_size - p->min_size + 1;
+    switch( p->dist )
+    {
+        case WORKLOAD_ZIPF:
+        {
+            double v = workload_rand( rval );
+            size_t lo = 0, hi = zipf_ranks - 1;
+            while( lo < hi )
+            {
+                size_t mid = ( lo + hi ) / 2;
+                if( zipf_cdf[ mid ] < v ) lo = mid + 1; else hi = mid;
+            }
+            return ( lo + 1 ) * p->min_size;
+        }
+
+        case WORKLOAD_UNIFORM:
+            return p->min_size + ( size_t )( workload_rand( rval ) * range );
+
+        case WORKLOAD_BIMODAL:
+        {
+            if( workload_rand( rval ) < 0.9 ) return p->min_size + ( size_t )( workload_rand( rval ) * p->min_size * 7 );
+            size_t lo = p->max_size / 4 > p->min_size ? p->max_size / 4 : p->min_size;
+            return lo + ( size_t )( workload_rand( rval ) * ( p->max_size - lo + 1 ) );
+        }
+
+        case WORKLOAD_FIXED:
+            return p->max_size;
+
+        default: // log-uniform
+            return p->min_size * pow( ( double )p->max_size / p->min_size, workload_rand( rval ) );
+    }
+}
+
+static workload_s* workload_s_create( const workload_params_s* p )
+{
+    if( p->min_size == 0 || p->max_size < p->min_size || p->table_size == 0 ) eval_err( "Invalid workload parameters." );
+
+    workload_s* o = malloc( sizeof( workload_s ) );
+    o->table_size = p->table_size;
+    o->ops = p->ops;
+    o->idx = malloc( p->ops * sizeof( uint32_t ) );
+    o->size = malloc( p->ops * sizeof( size_t ) );
+
+    size_t* live = calloc( p->table_size, sizeof( size_t ) ); // simulated slot state (current size)
+
+    size_t zipf_ranks = p->max_size / p->min_size;
+    double* zipf_cdf = NULL;
+    if( p->dist == WORKLOAD_ZIPF )
+    {
+        zipf_cdf = malloc( zipf_ranks * sizeof( double ) );
+        double sum = 0;
+        for( size_t k = 0; k < zipf_ranks; k++ ) zipf_cdf[ k ] = ( sum += 1.0 / ( k + 1 ) );
+        for( size_t k = 0; k < zipf_ranks; k++ ) zipf_cdf[ k ] /= sum;
+    }
+
+    size_t hot_slots = p->table_size / 16 > 0 ? p->table_size / 16 : 1;
+
+    uint32_t rval = p->seed;
+    for( size_t i = 0; i < p->ops; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval % p->table_size;
+        if( p->dist == WORKLOAD_LIFETIME && workload_rand( &rval ) < 0.9 ) idx %= hot_slots;
+
+        size_t size = 0;
+        if( p->dist == WORKLOAD_GROWTH )
+        {
+            size_t grown = live[ idx ] + live[ idx ] / 2;
+            size = ( live[ idx ] == 0 ) ? p->min_size : ( grown <= p->max_size ) ? grown : 0;
+        }
+        else if( live[ idx ] == 0 )
+        {
+            size = workload_draw_size( p, zipf_cdf, zipf_ranks, &rval );
+        }
+
+        o->idx[ i ] = idx;
+        o->size[ i ] = size;
+        live[ idx ] = size;
+    }
+
+    free( zipf_cdf );
+    free( live );
+    return o;
+}
+
+static void workload_s_discard( workload_s* o )
+{
+    if( !o ) return;
+    free( o->size );
+    free( o->idx );
+    free( o );
+}
+
+/// runs a workload timing each call and collecting counters; instances are freed afterwards (not measured)
+static void workload_s_run( const workload_s* o, fp_alloc alloc, latency_histogram_s* hist, hw_counters_s* counters )
+{
+    void**  data_table = calloc( o->table_size, sizeof( void* ) );
+    size_t* size_table = calloc( o->table_size, sizeof( size_t ) );
+    memset( hist, 0, sizeof( *hist ) );
+
+    hw_counters_s_start( counters );
+    for( size_t i = 0; i < o->ops; i++ )
+    {
+        size_t idx = o->idx[ i ];
+        uint64_t time = cycle_count();
+        data_table[ idx ] = alloc( data_table[ idx ], size_table[ idx ], o->size[ i ], &size_table[ idx ] );
+        latency_histogram_s_add( hist, cycle_count() - time );
+    }
+    hw_counters_s_stop( counters );
+
+    for( size_t i = 0; i < o->table_size; i++ ) data_table[ i ] = alloc( data_table[ i ], size_table[ i ], 0, NULL );
+
+    free( size_table );
+    free( data_table );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef enum workload_format { WORKLOAD_TEXT = 0, WORKLOAD_CSV, WORKLOAD_JSON } workload_format;
+
+static void workload_print
+(
+    workload_format format,
+    size_t row,
+    const workload_params_s* p,
+    const char* manager,
+    const tbman_params_s* man_params, // NULL: stdlib
+    const latency_histogram_s* hist,
+    const hw_counters_s* counters
+)
+{
+    // counters per operation (negative: unavailable)
+    double div = p->ops > 0 ? p->ops : 1;
+    double counter_arr[ HW_EVENTS + 2 ];
+    const char* counter_name[ HW_EVENTS + 2 ] = { "cycles", "instructions", "cache_misses", "dtlb_misses", "minor_faults", "major_faults" };
+    for( size_t i = 0; i < HW_EVENTS; i++ ) counter_arr[ i ] = counters->valid[ i ] ? counters->value[ i ] / div : -1;
+    counter_arr[ HW_EVENTS     ] = counters->faults_valid ? counters->minor_faults / div : -1;
+    counter_arr[ HW_EVENTS + 1 ] = counters->faults_valid ? counters->major_faults / div : -1;
+
+    double mean = hist->total > 0 ? ( hist->sum * cycle_ns() ) / hist->total : 0;
+    double p50  = latency_histogram_s_quantile( hist, 0.5 );
+    double p90  = latency_histogram_s_quantile( hist, 0.9 );
+    double p99  = latency_histogram_s_quantile( hist, 0.99 );
+    double p999 = latency_histogram_s_quantile( hist, 0.999 );
+    double max  = hist->max * cycle_ns();
+    tbman_params_s none = { 0 };
+    const tbman_params_s* m = man_params ? man_params : &none;
+
+    switch( format )
+    {
+        case WORKLOAD_CSV:
+        {
+            if( row == 0 )
+            {
+                printf( "dist,manager,ops,table_size,min_size,max_size,seed,pool_size,min_block_size,max_block_size,stepping_method,full_align,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" );
+                for( size_t i = 0; i < HW_EVENTS + 2; i++ ) printf( ",%s_per_op", counter_name[ i ] );
+                printf( "\n" );
+            }
+            printf
+            (
+                "%s,%s,%zu,%zu,%zu,%zu,%u,%zu,%zu,%zu,%zu,%i,%.1f,%.0f,%.0f,%.0f,%.0f,%.0f",
+                workload_dist_name[ p->dist ], manager, p->ops, p->table_size, p->min_size, p->max_size, p->seed,
+                m->pool_size, m->min_block_size, m->max_block_size, m->stepping_method, ( int )m->full_align,
+                mean, p50, p90, p99, p999, max
+            );
+            for( size_t i = 0; i < HW_EVENTS + 2; i++ )
+            {
+                if( counter_arr[ i ] >= 0 ) printf( ",%.4f", counter_arr[ i ] ); else printf( "," );
+            }
+            printf( "\n" );
+        }
+        break;
+
+        case WORKLOAD_JSON:
+        {
+            printf
+            (
+                "%s  { \"dist\": \"%s\", \"manager\": \"%s\", \"ops\": %zu, \"table_size\": %zu, \"min_size\": %zu, \"max_size\": %zu, \"seed\": %u,"
+                " \"pool_size\": %zu, \"min_block_size\": %zu, \"max_block_size\": %zu, \"stepping_method\": %zu, \"full_align\": %s,"
+                " \"mean_ns\": %.1f, \"p50_ns\": %.0f, \"p90_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f, \"max_ns\": %.0f",
+                row == 0 ? "[\n" : ",\n",
+                workload_dist_name[ p->dist ], manager, p->ops, p->table_size, p->min_size, p->max_size, p->seed,
+                m->pool_size, m->min_block_size, m->max_block_size, m->stepping_method, m->full_align ? "true" : "false",
+                mean, p50, p90, p99, p999, max
+            );
+            for( size_t i = 0; i < HW_EVENTS + 2; i++ )
+            {
+                if( counter_arr[ i ] >= 0 ) printf( ", \"%s_per_op\": %.4f", counter_name[ i ], counter_arr[ i ] );
+                else printf( ", \"%s_per_op\": null", counter_name[ i ] );
+            }
+            printf( " }" );
+        }
+        break;
+
+        default:
+        {
+            char name[ 64 ];
+            snprintf( name, sizeof( name ), "%-10s %-8s", workload_dist_name[ p->dist ], manager );
+            latency_histogram_s_print( hist, name );
+            if( counters->faults_valid || counters->valid[ 0 ] )
+            {
+                printf( "%*s ", ( int )strlen( name ), "" );
+                hw_counters_s_print( counters, p->ops );
+                printf( "\n" );
+            }
+        }
+        break;
+    }
+}
+
+static void workload_usage( void )
+{
+    printf
+    (
+        "usage: eval workload [options]\n"
+        "  --dist <name|all>        loguniform, zipf, uniform, bimodal, fixed, growth, lifetime (default: all)\n"
+        "  --manager <name|all>     stdlib, tbman (sizes not passed), tbman_n (sizes passed) (default: all)\n"
+        "  --ops <n>                operations (default: 1000000)\n"
+        "  --table <n>              table size (default: 100000)\n"
+        "  --min <bytes>            minimum size (default: 8)\n"
+        "  --max <bytes>            maximum size (default: 65536)\n"
+        "  --seed <n>               random seed (default: 1237)\n"
+        "  --pool-size <bytes>      tbman configuration (s. tbman_params_s)\n"
+        "  --min-block <bytes>\n"
+        "  --max-block <bytes>\n"
+        "  --stepping <n>\n"
+        "  --align <0|1>\n"
+        "  --format <text|csv|json> (default: text)\n"
+    );
+}
+
+/// command line entry: eval workload [options]; returns the exit status
+static int workload_main( int argc, char** argv )
+{
+    workload_params_s params;
+    workload_params_s_init( &params );
+    tbman_params_s man_params;
+    tbman_params_s_init( &man_params );
+    workload_format format = WORKLOAD_TEXT;
+    const char* dist = "all";
+    const char* manager = "all";
+
+    for( int i = 0; i < argc; i++ )
+    {
+        const char* arg = argv[ i ];
+        const char* val = ( i + 1 < argc ) ? argv[ i + 1 ] : NULL;
+        if( !strcmp( arg, "--help" ) ) { workload_usage(); return 0; }
+        if( !val ) { workload_usage(); return 1; }
+        i++;
+        if(      !strcmp( arg, "--dist"      ) ) dist = val;
+        else if( !strcmp( arg, "--manager"   ) ) manager = val;
+        else if( !strcmp( arg, "--ops"       ) ) params.ops = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--table"     ) ) params.table_size = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--min"       ) ) params.min_size = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--max"       ) ) params.max_size = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--seed"      ) ) params.seed = strtoul( val, NULL, 10 );
+        else if( !strcmp( arg, "--pool-size" ) ) man_params.pool_size = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--min-block" ) ) man_params.min_block_size = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--max-block" ) ) man_params.max_block_size = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--stepping"  ) ) man_params.stepping_method = strtoull( val, NULL, 10 );
+        else if( !strcmp( arg, "--align"     ) ) man_params.full_align = strtoul( val, NULL, 10 ) != 0;
+        else if( !strcmp( arg, "--format"    ) ) format = !strcmp( val, "csv" ) ? WORKLOAD_CSV : !strcmp( val, "json" ) ? WORKLOAD_JSON : WORKLOAD_TEXT;
+        else { workload_usage(); return 1; }
+    }
+
+    const char* manager_name[] = { "stdlib", "tbman", "tbman_n" };
+    fp_alloc manager_alloc[] = { external_nalloc, tbman_s_alloc_thread, tbman_s_nalloc_thread };
+    latency_histogram_s* hist = malloc( sizeof( latency_histogram_s ) );
+    hw_counters_s counters;
+    size_t row = 0;
+
+    for( size_t d = 0; d < WORKLOAD_DISTS; d++ )
+    {
+        if( strcmp( dist, "all" ) && strcmp( dist, workload_dist_name[ d ] ) ) continue;
+        params.dist = d;
+        workload_s* workload = workload_s_create( &params );
+
+        for( size_t m = 0; m < 3; m++ )
+        {
+            if( strcmp( manager, "all" ) && strcmp( manager, manager_name[ m ] ) ) continue;
+            if( m > 0 ) thread_man = tbman_s_create_with( &man_params );
+            workload_s_run( workload, manager_alloc[ m ], hist, &counters );
+            if( m > 0 )
+            {
+                tbman_s_discard( thread_man );
+                thread_man = NULL;
+            }
+            workload_print( format, row++, &params, manager_name[ m ], m > 0 ? &man_params : NULL, hist, &counters );
+        }
+
+        workload_s_discard( workload );
+    }
+
+    if( format == WORKLOAD_JSON ) printf( row > 0 ? "\n]\n" : "[]\n" );
+    free( hist );
+
+    if( row == 0 ) { workload_usage(); return 1; }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+// ---------------------------------------------------------------------------------------------------------------------
+/** Stress: Threads randomly allocate, reallocate and free (immediate, unsized, deferred, batched) on a shared manager.
+ *  Each instance carries a byte pattern verified before it is reallocated or freed. Afterwards the manager must be
+ *  consistent and hold no more instances than before.
+ */
+
+typedef struct stress_arg_s
+{
+    tbman_s* man; // NULL: global manager
+    size_t cycles;
+    uint32_t seed;
+    size_t errors;
+} stress_arg_s;
+
+static void stress_fill( uint8_t* ptr, size_t size, uint32_t key )
+{
+    for( size_t i = 0; i < size; i++ ) ptr[ i ] = ( uint8_t )( key + i * 7 );
+}
+
+static bool stress_verify( const uint8_t* ptr, size_t size, uint32_t key )
+{
+    for( size_t i = 0; i < size; i++ ) if( ptr[ i ] != ( uint8_t )( key + i * 7 ) ) return false;
+    return true;
+}
+
+static void* stress_thread_func( void* arg )
+{
+    stress_arg_s* o = arg;
+    enum { slots = 256 };
+    void* ptr_arr[ slots ] = { NULL };
+    size_t size_arr[ slots ] = { 0 };
+    uint32_t key_arr[ slots ] = { 0 };
+    void* batch_ptr_arr[ 16 ];
+    size_t batch_size_arr[ 16 ];
+    size_t batch_size = 0;
+    uint32_t rval = o->seed;
+
+    for( size_t i = 0; i < o->cycles; i++ )
+    {
+        rval = xsg_u2( rval );
+        size_t idx = rval % slots;
+        size_t mode = ( rval >> 8 ) & 7;
+        rval = xsg_u2( rval );
+        size_t size = ( rval & 15 ) == 0 ? 1 + ( rval >> 4 ) % 100000 : 1 + ( rval >> 4 ) % 1024;
+
+        if( ptr_arr[ idx ] && !stress_verify( ptr_arr[ idx ], size_arr[ idx ], key_arr[ idx ] ) ) o->errors++;
+
+        if( !ptr_arr[ idx ] )
+        {
+            ptr_arr[ idx ] = o->man ? tbman_s_alloc( o->man, NULL, size, NULL ) : tbman_alloc( NULL, size, NULL );
+            size_arr[ idx ] = size;
+            key_arr[ idx ] = rval;
+            stress_fill( ptr_arr[ idx ], size, rval );
+        }
+        else if( mode < 3 ) // realloc
+        {
+            size_t keep = size < size_arr[ idx ] ? size : size_arr[ idx ];
+            uint8_t* ptr = o->man ? tbman_s_nalloc( o->man, ptr_arr[ idx ], size_arr[ idx ], size, NULL )
+                                  : tbman_nalloc( ptr_arr[ idx ], size_arr[ idx ], size, NULL );
+            if( !stress_verify( ptr, keep, key_arr[ idx ] ) ) o->errors++;
+            ptr_arr[ idx ] = ptr;
+            size_arr[ idx ] = size;
+            key_arr[ idx ] = rval;
+            stress_fill( ptr, size, rval );
+        }
+        else
+        {
+            void* ptr = ptr_arr[ idx ];
+            size_t free_size = size_arr[ idx ];
+            ptr_arr[ idx ] = NULL;
+            switch( mode )
+            {
+                case 3: o->man ? tbman_s_nfree( o->man, ptr, free_size ) : tbman_nfree( ptr, free_size ); break;
+                case 4: o->man ? tbman_s_free( o->man, ptr ) : tbman_free( ptr ); break;
+                case 5: o->man ? tbman_s_free_deferred( o->man, ptr, free_size ) : tbman_free_deferred( ptr, free_size ); break;
+                default:
+                {
+                    batch_ptr_arr[ batch_size ] = ptr;
+                    batch_size_arr[ batch_size ] = free_size;
+                    if( ++batch_size == 16 )
+                    {
+                        o->man ? tbman_s_free_batch( o->man, batch_ptr_arr, batch_size_arr, batch_size )
+                               : tbman_free_batch( batch_ptr_arr, batch_size_arr, batch_size );
+                        batch_size = 0;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    if( batch_size > 0 )
+    {
+        o->man ? tbman_s_free_batch( o->man, batch_ptr_arr, batch_size_arr, batch_size )
+               : tbman_free_batch( batch_ptr_arr, batch_size_arr, batch_size );
+    }
+
+    for( size_t i = 0; i < slots; i++ )
+    {
+        if( !ptr_arr[ i ] ) continue;
+        if( !stress_verify( ptr_arr[ i ], size_arr[ i ], key_arr[ i ] ) ) o->errors++;
+        o->man ? tbman_s_nfree( o->man, ptr_arr[ i ], size_arr[ i ] ) : tbman_nfree( ptr_arr[ i ], size_arr[ i ] );
+    }
+    return NULL;
+}
+
+/// runs the stress threads on 'man' (NULL: global manager); returns number of integrity errors
+static size_t stress_run( tbman_s* man, size_t threads, size_t cycles )
+{
+    pthread_t thread_arr[ 64 ];
+    stress_arg_s arg_arr[ 64 ];
+    if( threads > 64 ) threads = 64;
+
+    for( size_t i = 0; i < threads; i++ )
+    {
+        arg_arr[ i ] = ( stress_arg_s ){ .man = man, .cycles = cycles, .seed = 7919 + i };
+        pthread_create( &thread_arr[ i ], NULL, stress_thread_func, &arg_arr[ i ] );
+    }
+
+    size_t errors = 0;
+    for( size_t i = 0; i < threads; i++ )
+    {
+        pthread_join( thread_arr[ i ], NULL );
+        errors += arg_arr[ i ].errors;
+    }
+
+    man ? tbman_s_flush_deferred( man ) : tbman_flush_deferred();
+    return errors;
+}
+
+static void tbman_stress( void )
+{
+    size_t threads = 8;
+    size_t cycles  = 50000;
+
+    {
+        printf( "\nshared manager (%zu threads, maintenance thread, deferred frees) ... ", threads );
+        tbman_s* man = tbman_s_open_locked();
+        tbman_s_set_deferred_limit( man, 64 );
+        tbman_s_maintenance_start( man, 1, 100 );
+        ASSERT( stress_run( man, threads, cycles ) == 0 );
+        tbman_s_maintenance_stop( man );
+        ASSERT( tbman_s_total_instances( man ) == 0 );
+        ASSERT( tbman_s_check_consistency( man ) );
+        tbman_s_close( man );
+        printf( "success!\n");
+    }
+
+    if( !default_unlocked() )
+    {
+        printf( "\nglobal manager (%zu threads) ... ", threads );
+        size_t instances = tbman_total_instances();
+        ASSERT( stress_run( NULL, threads, cycles ) == 0 );
+        ASSERT( tbman_total_instances() == instances );
+        printf( "success!\n");
+    }
+}
+
+#endif // defined( __unix__ ) || defined( __APPLE__ )
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// benchmarks (speed, latency, scaling, footprint)
+static void tbman_benchmark( void )
+{
+    size_t table_size = 100000;
+    size_t cycles     = 10;
+    size_t max_alloc  = 65536;
+    size_t seed       = 1237;
+
+    bool verbose      = false; // set 'true' for more expressive test results
+
+    printf( "Memory Manager Benchmarks:\n");
+    {
+        printf( "\nmalloc, free, realloc (stdlib) ...\n");
+        alloc_challenge( external_nalloc, table_size, cycles, max_alloc, seed, true, verbose );
+        alloc_latency_challenge( external_nalloc, table_size, cycles, max_alloc, seed );
+    }
+
+    {
+        printf( "\ntbman_malloc, tbman_free, tbman_realloc ...\n");
+        alloc_challenge( tbman_nalloc_no_current_bytes, table_size, cycles, max_alloc, seed, true, verbose );
+        alloc_latency_challenge( tbman_nalloc_no_current_bytes, table_size, cycles, max_alloc, seed );
+    }
+
+    {
+        printf( "\ntbman_malloc, tbman_nfree, tbman_nrealloc ...\n");
+        alloc_challenge( tbman_nalloc, table_size, cycles, max_alloc, seed, true, verbose );
+        alloc_latency_challenge( tbman_nalloc, table_size, cycles, max_alloc, seed );
+    }
+
+    {
+        printf( "\nlock policy of a dedicated manager (single thread, alloc-free local) ...\n");
+        lock_policy_challenge( TBMAN_LOCK_MUTEX, "mutex ", 10000000 );
+        lock_policy_challenge( TBMAN_LOCK_SPIN,  "spin  ", 10000000 );
+        lock_policy_challenge( TBMAN_LOCK_NONE,  "none  ", 10000000 );
+        lock_policy_challenge( TBMAN_LOCK_ADAPTIVE, "adapt ", 10000000 );
+    }
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+    {
+        printf( "\nlock policy of a shared manager (4 threads, alloc-free local) ...\n");
+        lock_policy_mt_challenge( TBMAN_LOCK_MUTEX,    "mutex ", 4, 2000000 );
+        lock_policy_mt_challenge( TBMAN_LOCK_SPIN,     "spin  ", 4, 2000000 );
+        lock_policy_mt_challenge( TBMAN_LOCK_ADAPTIVE, "adapt ", 4, 2000000 );
+    }
+
+    {
+        printf( "\nlock hold time (1 thread reallocating up to 4MB, 3 threads alloc-free local) ...\n");
+        lock_hold_challenge( 4, 2000000, 2000 );
+    }
+
+    {
+        printf( "\nthread scaling (alloc-free and realloc per thread, 1 ... cores threads) ...\n");
+        thread_scaling_challenge( 10000, 20, max_alloc );
+    }
+
+    {
+        printf( "\nproducer-consumer (1 producer, 2 consumers, sizes 8 ... 1031, queue depth sweep) ...\n");
+        producer_consumer_challenge( 1, 2, 200000 );
+    }
+
+    {
+        printf( "\nmemory footprint (overhead ratio at peak -> steady state) ...\n");
+        footprint_challenge( 100000 );
+    }
+
+    {
+        printf( "\nsoak (phases with shifting size distribution and live set) ...\n");
+        soak_challenge( 2, 1000000 );
+    }
+#endif
+
+    {
+        printf( "\ntbman_s_alloc_batch versus single allocations ...\n");
+        alloc_batch_challenge( 40, 1000000 );
+        alloc_batch_challenge( 20000, 1000 );
+    }
+
+    {
+        printf( "\ntbman_s_free_batch versus single frees ...\n");
+        free_batch_challenge( 1024, 1000000, false );
+        free_batch_challenge( 1024, 1000000, true );
+        free_batch_challenge( 40000, 10000, false );
+    }
+
+    {
+        printf( "\nrealloc growth (250 buffers grown element by element, capacity = granted size) ...\n");
+        growth_challenge();
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// functional tests (abort on failure)
+static void tbman_selftest( void )
+{
+    printf( "\nMemory Manager Tests:\n");
+
+    {
+        printf( "\ndiagnostic test ... ");
+        tbman_s_diagnostic_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\narena test ... ");
+        tbman_arena_s_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nslab test ... ");
+        tbman_slab_s_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nreset test ... ");
+        tbman_s_reset_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nprovider test ... ");
+        tbman_provider_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nprovider calls outside the lock test ... ");
+        tbman_provider_unlocked_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\ngood size test ... ");
+        tbman_s_good_size_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nexpand test ... ");
+        tbman_s_expand_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nsweep adaptation test ... ");
+        tbman_s_sweep_adapt_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nmaintenance test ... ");
+        tbman_s_maintenance_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\ndeferred free test ... ");
+        tbman_s_free_deferred_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\nregion test ... ");
+        tbman_s_region_test();
+        printf( "success!\n");
+    }
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+    {
+        printf( "\npersistent manager test ... ");
+        tbman_s_persistent_test();
+        printf( "success!\n");
+    }
+#endif
+
+#ifdef __linux__
+    {
+        printf( "\nregion shared between processes test ... ");
+        tbman_s_region_shared_test();
+        printf( "success!\n");
+    }
+
+    {
+        printf( "\npersistent manager shared between processes test ... ");
+        tbman_s_persistent_shared_test();
+        printf( "success!\n");
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_test( void )
+{
+    tbman_benchmark();
+    tbman_selftest();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+int main( int argc, char** argv )
+{
+    tbman_open();
+    int status = 0;
+    if( argc <= 1 )
+    {
+        tbman_test();
+    }
+    else if( !strcmp( argv[ 1 ], "workload" ) )
+    {
+        status = workload_main( argc - 2, argv + 2 );
+    }
+    else if( !strcmp( argv[ 1 ], "test" ) )
+    {
+        tbman_selftest();
+    }
+    else if( !strcmp( argv[ 1 ], "bench" ) )
+    {
+        tbman_benchmark();
+    }
+#if defined( __unix__ ) || defined( __APPLE__ )
+    else if( !strcmp( argv[ 1 ], "stress" ) )
+    {
+        tbman_stress();
+    }
+#endif
+#ifdef __linux__
+    else if( !strcmp( argv[ 1 ], "child" ) )
+    {
+        status = eval_child_main( argc - 2, argv + 2 );
+    }
+#endif
+    else
+    {
+        printf( "usage: %s [test | bench | stress | workload [options]]\n", argv[ 0 ] );
+        printf( "       no argument runs benchmarks and tests\n" );
+        status = 1;
+    }
     tbman_close();
+    return status;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -24,6 +24,7 @@ SOFTWARE.
 #include "btree.h"
 
 #include <cstdlib>
+#include <cstdint>
 #include <cstdio>
 #include <cstdarg>
 #include <cassert>
@@ -31,6 +32,31 @@ SOFTWARE.
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+    #define TBMAN_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <signal.h>
+    #include <pthread.h>
+    #include <sys/file.h>
+    #include <cerrno>
+#endif
+
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
+#ifdef __linux__
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
 
 using namespace std;
 
@@ -43,6 +69,15 @@ static const size_t default_max_block_size = 1024 * 16;
 static const size_t default_stepping_method = 1;
 static const bool default_full_align = true;
 
+/// Default concurrency control (s. tbman_params_s_init); build variants may override these
+#ifndef TBMAN_DEFAULT_LOCK_POLICY
+    #define TBMAN_DEFAULT_LOCK_POLICY TBMAN_LOCK_MUTEX
+#endif
+
+#ifndef TBMAN_DEFAULT_LOCK_TIMING
+    #define TBMAN_DEFAULT_LOCK_TIMING false
+#endif
+
 /// Minimum alignment of memory blocks
 #define TBMAN_ALIGN 0x100
 
@@ -66,20 +101,703 @@ static void ext_err(const char *func, const char *file, int line, const char *fo
  if( tbman_s_g == NULL ) ERR( "Manager was not initialized. Call tbman_open() at the beginning of your program." )
 
 /**********************************************************************************************************************/
+/** Lock
+ *
+ *  Governs concurrent access to a manager. Satisfies BasicLockable (usable with lock_guard).
+ *    TBMAN_LOCK_MUTEX:    std::mutex (default)
+ *    TBMAN_LOCK_SPIN:     spin lock on an atomic flag. The flag is address-free, hence the lock also serializes
+ *                         processes sharing the memory holding it (used by managers inside a memory region).
+ *                         A shared spin lock (locks inside a region) holds the id of the locking process instead of
+ *                         the flag, so that a lock left behind by a terminated process can be recognized and released
+ *                         (s. region_s_recover_lock).
+ *    TBMAN_LOCK_NONE:     no locking; the manager is used by a single thread (its owner).
+ *                         With RTCHECKS, access from a foreign thread is reported as error.
+ *    TBMAN_LOCK_ADAPTIVE: spins briefly (critical sections are short), then sleeps on a futex (linux) or yields.
+ *                         State: 0: unlocked; 1: locked; 2: locked with (possibly) sleeping waiters
+ *
+ *  Statistics are updated by the lock holder and need no synchronization of their own.
+ *  With timing enabled, the hold time of each acquisition is measured (two clock readings per acquisition).
+ */
+static const size_t adaptive_spin_limit = 128;
 
-static inline void *stdlib_alloc(void *current_ptr, size_t requested_size) {
-    if (requested_size == 0) {
-        if (current_ptr) free(current_ptr);
-        current_ptr = NULL;
-    } else {
-        if (current_ptr) {
-            current_ptr = realloc(current_ptr, requested_size);
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline void futex_wait(std::atomic<uint32_t> *state, uint32_t value) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *) state, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+    std::this_thread::yield();
+#endif
+}
+
+static inline void futex_wake(std::atomic<uint32_t> *state) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *) state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Id of the calling process (cached; reset in a forked child)
+static std::atomic<uint32_t> process_id_cache{0};
+
+#ifdef TBMAN_MMAP
+static void process_id_reset(void) {
+    process_id_cache.store(0, std::memory_order_relaxed);
+}
+
+static void process_id_register_reset(void) {
+    pthread_atfork(NULL, NULL, process_id_reset);
+}
+#endif
+
+static uint32_t process_id(void) {
+    uint32_t id = process_id_cache.load(std::memory_order_relaxed);
+    if (id) return id;
+#ifdef TBMAN_MMAP
+    static std::once_flag flag;
+    std::call_once(flag, process_id_register_reset);
+    id = (uint32_t) getpid();
+#else
+    id = 1; // processes are not distinguished
+#endif
+    process_id_cache.store(id, std::memory_order_relaxed);
+    return id;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// true when process 'id' exists (a terminated process may have its id reused; the test is conservative)
+static bool process_alive(uint32_t id) {
+#ifdef TBMAN_MMAP
+    return kill((pid_t) id, 0) == 0 || errno == EPERM;
+#else
+    return true;
+#endif
+}
+
+typedef struct tbman_lock_s {
+    tbman_lock_policy policy;
+    std::mutex mutex;
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+    std::atomic<uint32_t> state{0};
+    bool shared = false;               // spin lock shared among processes: locking stores the process id in holder
+    std::atomic<uint32_t> holder{0};   // process holding a shared lock (0: unlocked)
+    tbman_lock_stats_s stats = {};
+    bool timing = false;
+    std::chrono::steady_clock::time_point acquired;
+#ifdef RTCHECKS
+    std::thread::id owner = std::this_thread::get_id();
+#endif
+
+    void lock() {
+        switch (policy) {
+            case TBMAN_LOCK_NONE:
+#ifdef RTCHECKS
+                if( owner != std::this_thread::get_id() ) ERR( "Unlocked manager accessed by a foreign thread." );
+#endif
+                break;
+
+            case TBMAN_LOCK_SPIN: {
+                size_t spins = 0;
+                if (shared) {
+                    uint32_t id = process_id(), c = 0;
+                    while (!holder.compare_exchange_weak(c, id, std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                        spins++;
+                        c = 0;
+                    }
+                } else {
+                    while (flag.test_and_set(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                        spins++;
+                    }
+                }
+                stats.contended += spins > 0;
+                stats.spins += spins;
+            }
+                break;
+
+            case TBMAN_LOCK_ADAPTIVE: {
+                uint32_t c = 0;
+                if (state.compare_exchange_strong(c, 1, std::memory_order_acquire)) break;
+
+                size_t spins = 0;
+                for (; spins < adaptive_spin_limit; spins++) {
+                    cpu_relax();
+                    c = 0;
+                    if (state.load(std::memory_order_relaxed) == 0 &&
+                        state.compare_exchange_weak(c, 1, std::memory_order_acquire))
+                        break;
+                }
+
+                size_t sleeps = 0;
+                if (spins == adaptive_spin_limit) {
+                    c = state.exchange(2, std::memory_order_acquire);
+                    while (c != 0) {
+                        futex_wait(&state, 2);
+                        sleeps++;
+                        c = state.exchange(2, std::memory_order_acquire);
+                    }
+                }
+                stats.contended++;
+                stats.spins += spins;
+                stats.sleeps += sleeps;
+            }
+                break;
+
+            default:
+                if (!mutex.try_lock()) {
+                    mutex.lock();
+                    stats.contended++;
+                }
+                break;
+        }
+        stats.acquisitions++;
+        if (timing) acquired = std::chrono::steady_clock::now();
+    }
+
+    void unlock() {
+        if (timing) {
+            size_t hold_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - acquired).count();
+            stats.hold_ns += hold_ns;
+            if (hold_ns > stats.max_hold_ns) stats.max_hold_ns = hold_ns;
+        }
+        switch (policy) {
+            case TBMAN_LOCK_NONE:
+                break;
+            case TBMAN_LOCK_SPIN:
+                if (shared) {
+                    holder.store(0, std::memory_order_release);
+                } else {
+                    flag.clear(std::memory_order_release);
+                }
+                break;
+            case TBMAN_LOCK_ADAPTIVE:
+                if (state.exchange(0, std::memory_order_release) == 2) futex_wake(&state);
+                break;
+            default:
+                mutex.unlock();
+                break;
+        }
+    }
+} tbman_lock_s;
+
+/**********************************************************************************************************************/
+/** Region
+ *
+ *  First-fit allocator over a caller-provided memory region (e.g. shared memory or a mapped file).
+ *  A manager created in a region obtains all its memory from the region: the manager instance, metadata,
+ *  btree nodes, memory pools and external blocks.
+ *
+ *  Free chunks form an address-ordered singly linked list; adjacent free chunks are merged when freeing.
+ *  Each allocated block is preceded by a header (region_head_s) identifying its chunk.
+ *  Leading space lost to alignment is returned to the free list where possible.
+ *
+ *  Internal references are absolute addresses. A region must therefore be mapped at the same address in all
+ *  processes using it; this is verified when attaching.
+ *  The region holds no process specific state: function addresses (provider, btree allocation) are resolved by the
+ *  calling process (s. provider_region_functions, btree_set_shared_alloc).
+ *
+ *  Processes opening a region via tbman_s_open_file register their id in the region (attach table). Region and
+ *  manager locks are shared spin locks recording their holder. A lock whose holder is not a registered live
+ *  process was left behind by a terminated process and is released when the region is opened.
+ */
+#define REGION_MAGIC 0x4E414D4254474552ull
+#define REGION_VERSION 3 // incremented on changes of the persistent representation
+#define REGION_GRAIN 16
+#define REGION_ATTACH_MAX 64 // processes simultaneously having a region opened
+
+typedef struct region_chunk_s {
+    size_t size;                  // size of free chunk
+    struct region_chunk_s *next;  // next free chunk (higher address)
+} region_chunk_s;
+
+typedef struct region_head_s {
+    uint8_t *chunk;               // begin of the chunk holding the block
+    size_t size;                  // size of the chunk
+} region_head_s;
+
+/// Leading fields of a region: plain data, read from a file before mapping it (s. tbman_s_open_file)
+typedef struct region_header_s {
+    uint64_t magic;
+    size_t layout;                // identifies the binary layout of region and manager
+    struct region_s *self;        // address of the region at creation
+    size_t size;
+} region_header_s;
+
+typedef struct region_s : region_header_s {
+    region_chunk_s *free_list;
+    struct tbman_s *manager;
+    std::atomic<size_t> attached;                       // processes having the region opened
+    std::atomic<uint32_t> attach_id[REGION_ATTACH_MAX]; // ids of these processes (0: free entry)
+    tbman_lock_s lock;
+} region_s;
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static inline uint8_t *align_up(uint8_t *ptr, size_t align) {
+    return (uint8_t *) (((uintptr_t) ptr + (align - 1)) & ~(uintptr_t) (align - 1));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t region_s_layout(void);
+
+static region_s *region_s_create(void *base, size_t size) {
+    region_s *o = (region_s *) align_up((uint8_t *) base, REGION_GRAIN);
+    uint8_t *beg = align_up((uint8_t *) (o + 1), REGION_GRAIN);
+    uint8_t *end = (uint8_t *) base + size;
+    if (end < beg + sizeof(region_chunk_s)) ERR("Region of %zu bytes is too small", size);
+    end = beg + ((size_t) (end - beg) & ~(size_t) (REGION_GRAIN - 1));
+
+    new(o) region_s{};
+    o->lock.policy = TBMAN_LOCK_SPIN;
+    o->lock.shared = true;
+    o->magic = REGION_MAGIC;
+    o->layout = region_s_layout();
+    o->self = o;
+    o->size = size;
+    o->manager = NULL;
+    o->free_list = (region_chunk_s *) beg;
+    o->free_list->size = end - beg;
+    o->free_list->next = NULL;
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static region_s *region_s_attach(void *base) {
+    region_s *o = (region_s *) align_up((uint8_t *) base, REGION_GRAIN);
+    if (o->magic != REGION_MAGIC) ERR("No region found at %p", base);
+    if (o->layout != region_s_layout()) ERR("Region at %p was created by an incompatible build", base);
+    if (o->self != o) ERR("Region created at %p is mapped at %p; regions must be mapped at their original address", (void *) o->self, (void *) o);
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Returns a block of 'size' bytes aligned to 'align' (power of two); NULL when the region is exhausted
+static void *region_s_alloc(region_s *o, size_t align, size_t size) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    size = (size + (REGION_GRAIN - 1)) & ~(size_t) (REGION_GRAIN - 1);
+    if (align < REGION_GRAIN) align = REGION_GRAIN;
+
+    region_chunk_s **link = &o->free_list;
+    for (region_chunk_s *chunk = o->free_list; chunk; link = &chunk->next, chunk = chunk->next) {
+        uint8_t *beg = (uint8_t *) chunk;
+        uint8_t *end = beg + chunk->size;
+        uint8_t *ptr = align_up(beg + sizeof(region_head_s), align);
+        if (ptr + size > end) continue;
+
+        region_chunk_s *next = chunk->next;
+        uint8_t *lead = ptr - sizeof(region_head_s);
+        if (lead > beg) { // leading space remains a free chunk
+            chunk->size = lead - beg;
+            link = &chunk->next;
         } else {
-            current_ptr = malloc(requested_size);
+            *link = next;
+        }
+
+        uint8_t *tail = ptr + size;
+        if (tail < end) { // trailing space becomes a free chunk
+            region_chunk_s *rest = (region_chunk_s *) tail;
+            rest->size = end - tail;
+            rest->next = next;
+            *link = rest;
+        } else {
+            *link = next;
+        }
+
+        region_head_s *head = (region_head_s *) lead;
+        head->chunk = lead;
+        head->size = tail - lead;
+        return ptr;
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void region_s_free(region_s *o, void *ptr) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    region_head_s *head = (region_head_s *) ptr - 1;
+    uint8_t *beg = head->chunk;
+    size_t size = head->size;
+
+    region_chunk_s *prev = NULL;
+    region_chunk_s *next = o->free_list;
+    while (next && (uint8_t *) next < beg) {
+        prev = next;
+        next = next->next;
+    }
+
+    region_chunk_s *chunk = (region_chunk_s *) beg;
+    chunk->size = size;
+    chunk->next = next;
+    if (prev) prev->next = chunk; else o->free_list = chunk;
+
+    if (next && beg + chunk->size == (uint8_t *) next) {
+        chunk->size += next->size;
+        chunk->next = next->next;
+    }
+
+    if (prev && (uint8_t *) prev + prev->size == beg) {
+        prev->size += chunk->size;
+        prev->next = chunk->next;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Grows a block in place by absorbing (part of) the free chunk immediately following it.
+ *  Returns the new usable size (at least min_size, preferably max_size); 0 when no sufficient neighbor is free.
+ */
+static size_t region_s_expand(region_s *o, void *ptr, size_t min_size, size_t max_size) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    region_head_s *head = (region_head_s *) ptr - 1;
+    uint8_t *end = head->chunk + head->size;
+    size_t space = end - (uint8_t *) ptr;
+    if (space >= min_size) return space;
+
+    region_chunk_s **link = &o->free_list;
+    while (*link && (uint8_t *) *link < end) link = &(*link)->next;
+    region_chunk_s *next = *link;
+    if ((uint8_t *) next != end || space + next->size < min_size) return 0;
+
+    size_t take = ((max_size > space + next->size ? space + next->size : max_size) - space + (REGION_GRAIN - 1)) &
+                  ~(size_t) (REGION_GRAIN - 1);
+    if (take + sizeof(region_chunk_s) > next->size) {
+        take = next->size; // remainder too small to form a chunk
+        *link = next->next;
+    } else {
+        region_chunk_s *rest = (region_chunk_s *) (end + take);
+        rest->size = next->size - take;
+        rest->next = next->next;
+        *link = rest;
+    }
+    head->size += take;
+    return space + take;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Returns true when the free list is ordered, disjoint and inside the region
+static bool region_s_check(region_s *o) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    uint8_t *beg = (uint8_t *) (o + 1);
+    uint8_t *end = (uint8_t *) o + o->size;
+    for (region_chunk_s *chunk = o->free_list; chunk; chunk = chunk->next) {
+        if ((uint8_t *) chunk < beg || (uint8_t *) chunk + chunk->size > end) return false;
+        if (chunk->size < sizeof(region_chunk_s)) return false;
+        beg = (uint8_t *) chunk + chunk->size;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// true when process 'id' is registered in the attach table
+static bool region_s_attached(region_s *o, uint32_t id) {
+    for (size_t i = 0; i < REGION_ATTACH_MAX; i++) if (o->attach_id[i].load() == id) return true;
+    return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Registers the calling process; returns false when the attach table is full
+static bool region_s_register(region_s *o) {
+    uint32_t id = process_id();
+    for (size_t i = 0; i < REGION_ATTACH_MAX; i++) {
+        uint32_t c = 0;
+        if (o->attach_id[i].compare_exchange_strong(c, id)) {
+            o->attached.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Removes the registration of the calling process; returns false when it was not registered
+static bool region_s_unregister(region_s *o) {
+    uint32_t id = process_id();
+    for (size_t i = 0; i < REGION_ATTACH_MAX; i++) {
+        uint32_t c = id;
+        if (o->attach_id[i].compare_exchange_strong(c, 0)) {
+            o->attached.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Removes registrations of terminated processes (processes that did not close the region); returns their number
+static size_t region_s_prune(region_s *o) {
+    size_t pruned = 0;
+    for (size_t i = 0; i < REGION_ATTACH_MAX; i++) {
+        uint32_t id = o->attach_id[i].load();
+        if (id == 0 || process_alive(id)) continue;
+        if (o->attach_id[i].compare_exchange_strong(id, 0)) {
+            o->attached.fetch_sub(1);
+            pruned++;
+        }
+    }
+    return pruned;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Releases a shared lock of the region whose holder is not a registered live process.
+ *  Returns true when the lock was released. Locks of live processes are never touched.
+ */
+static bool region_s_recover_lock(region_s *o, tbman_lock_s *lock) {
+    uint32_t id = lock->holder.load();
+    if (id == 0 || (process_alive(id) && region_s_attached(o, id))) return false;
+    return lock->holder.compare_exchange_strong(id, 0);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Provider drawing from a region
+static void *region_provider_reserve(void *arg, size_t size) {
+    return region_s_alloc((region_s *) arg, REGION_GRAIN, size);
+}
+
+static void *region_provider_reserve_aligned(void *arg, size_t align, size_t size) {
+    return region_s_alloc((region_s *) arg, align, size);
+}
+
+static void region_provider_release(void *arg, void *ptr, size_t size) {
+    region_s_free((region_s *) arg, ptr);
+}
+
+static size_t region_provider_expand(void *arg, void *ptr, size_t size, size_t min_size, size_t max_size) {
+    return region_s_expand((region_s *) arg, ptr, min_size, max_size);
+}
+
+/** Functions of region providers.
+ *  A region manager holds its provider inside the region, where function addresses are invalid for other processes.
+ *  The provider therefore only holds the region (same address in all processes); the calling process resolves
+ *  the functions here (s. provider_functions).
+ */
+static const tbman_provider_s provider_region_functions =
+        {NULL, region_provider_reserve, region_provider_release, NULL, region_provider_reserve_aligned, region_provider_expand};
+
+static tbman_provider_s region_s_provider(region_s *o) {
+    tbman_provider_s provider = {};
+    provider.arg = o;
+    return provider;
+}
+
+/**********************************************************************************************************************/
+/** Providers
+ *
+ *  system: aligned heap allocation (default)
+ *  mmap:   anonymous memory mappings; aligned reservations over-map and trim the excess;
+ *          expansion uses the page slack of a mapping or extends it via mremap (linux)
+ */
+static void *system_reserve_aligned(void *arg, size_t align, size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    void *ptr = NULL;
+    if (align < sizeof(void *)) align = sizeof(void *);
+    return posix_memalign(&ptr, align, size) == 0 ? ptr : NULL;
+#endif
+}
+
+static void *system_reserve(void *arg, size_t size) {
+    return system_reserve_aligned(arg, 16, size);
+}
+
+static void system_release(void *arg, void *ptr, size_t size) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static const tbman_provider_s provider_system = {NULL, system_reserve, system_release, NULL, system_reserve_aligned, NULL};
+
+const tbman_provider_s *tbman_provider_system(void) {
+    return &provider_system;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifdef TBMAN_MMAP
+
+static size_t mmap_page_size(void) {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+static void *mmap_reserve(void *arg, size_t size) {
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void *mmap_reserve_aligned(void *arg, size_t align, size_t size) {
+    size_t page_size = mmap_page_size();
+    if (align <= page_size) return mmap_reserve(arg, size);
+    uint8_t *base = (uint8_t *) mmap_reserve(arg, size + align);
+    if (!base) return NULL;
+    uint8_t *ptr = align_up(base, align);
+    uint8_t *end = align_up(base + size + align, page_size);
+    uint8_t *tail = align_up(ptr + size, page_size);
+    if (ptr > base) munmap(base, ptr - base);
+    if (end > tail) munmap(tail, end - tail);
+    return ptr;
+}
+
+static void mmap_release(void *arg, void *ptr, size_t size) {
+    munmap(ptr, size);
+}
+
+static void mmap_decommit(void *arg, void *ptr, size_t size) {
+    size_t page_size = mmap_page_size();
+    uint8_t *beg = align_up((uint8_t *) ptr, page_size);
+    uint8_t *end = (uint8_t *) ((uintptr_t) ((uint8_t *) ptr + size) & ~(uintptr_t) (page_size - 1));
+    if (end > beg) madvise(beg, end - beg, MADV_DONTNEED);
+}
+
+static size_t mmap_expand(void *arg, void *ptr, size_t size, size_t min_size, size_t max_size) {
+    size_t page_size = mmap_page_size();
+    size_t mapped = (size + page_size - 1) & ~(page_size - 1);
+    if (mapped < min_size) {
+#ifdef __linux__
+        size_t target = (max_size + page_size - 1) & ~(page_size - 1);
+        if (mremap(ptr, mapped, target, 0) == MAP_FAILED) {
+            target = (min_size + page_size - 1) & ~(page_size - 1);
+            if (mremap(ptr, mapped, target, 0) == MAP_FAILED) return 0;
         }
-        if (!current_ptr) ERR("Failed allocating %zu bytes", requested_size);
+        mapped = target;
+#else
+        return 0;
+#endif
     }
-    return current_ptr;
+    return mapped < max_size ? mapped : max_size;
+}
+
+static const tbman_provider_s provider_mmap =
+        {NULL, mmap_reserve, mmap_release, mmap_decommit, mmap_reserve_aligned, mmap_expand};
+
+const tbman_provider_s *tbman_provider_mmap(void) {
+    return &provider_mmap;
+}
+
+#else
+
+const tbman_provider_s *tbman_provider_mmap(void) {
+    return NULL;
+}
+
+#endif // TBMAN_MMAP
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Returns the functions of a provider: region providers hold none (s. provider_region_functions)
+static inline const tbman_provider_s *provider_functions(const tbman_provider_s *o) {
+    return o->reserve ? o : &provider_region_functions;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static inline void *provider_reserve(const tbman_provider_s *o, size_t size) {
+    return provider_functions(o)->reserve(o->arg, size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static inline void provider_release(const tbman_provider_s *o, void *ptr, size_t size) {
+    provider_functions(o)->release(o->arg, ptr, size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Reserves aligned memory; falls back to reserve when the provider offers no aligned reservation
+static void *provider_reserve_aligned(const tbman_provider_s *o, size_t align, size_t size) {
+    const tbman_provider_s *f = provider_functions(o);
+    return f->reserve_aligned ? f->reserve_aligned(o->arg, align, size) : f->reserve(o->arg, size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Decommits a range if the provider supports it
+static inline void provider_decommit(const tbman_provider_s *o, void *ptr, size_t size) {
+    const tbman_provider_s *f = provider_functions(o);
+    if (f->decommit) f->decommit(o->arg, ptr, size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Grows a reservation in place; returns the new size or 0 if the provider cannot expand
+static inline size_t provider_expand(const tbman_provider_s *o, void *ptr, size_t size, size_t min_size, size_t max_size) {
+    const tbman_provider_s *f = provider_functions(o);
+    return f->expand ? f->expand(o->arg, ptr, size, min_size, max_size) : 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Metadata allocation (realloc semantics) via a provider.
+ *  Each block is preceded by a header holding its size, which the provider's release function requires.
+ */
+#define META_HEAD 16
+
+static void *meta_alloc(const tbman_provider_s *provider, void *current_ptr, size_t requested_size) {
+    uint8_t *current_head = current_ptr ? (uint8_t *) current_ptr - META_HEAD : NULL;
+    size_t current_size = current_head ? *(size_t *) current_head : 0;
+
+    if (requested_size == 0) {
+        if (current_head) provider_release(provider, current_head, current_size + META_HEAD);
+        return NULL;
+    }
+
+    uint8_t *reserved_head = (uint8_t *) provider_reserve(provider, requested_size + META_HEAD);
+    if (!reserved_head) ERR("Failed allocating %zu bytes", requested_size);
+    *(size_t *) reserved_head = requested_size;
+    if (current_head) {
+        memcpy(reserved_head + META_HEAD, current_ptr, current_size < requested_size ? current_size : requested_size);
+        provider_release(provider, current_head, current_size + META_HEAD);
+    }
+    return reserved_head + META_HEAD;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void *meta_btree_alloc(void *arg, void *current_ptr, size_t requested_size) {
+    return meta_alloc((const tbman_provider_s *) arg, current_ptr, requested_size);
+}
+
+/// Sets meta_btree_alloc as alloc function of shared btrees in the calling process (once per process)
+static void meta_btree_share(void) {
+    static std::once_flag flag;
+    std::call_once(flag, btree_set_shared_alloc, meta_btree_alloc);
+}
+
+/// Trees of region providers are shared: they store no function address (s. provider_region_functions)
+static btree_vd_s *meta_btree_vd_s_create(const tbman_provider_s *provider) {
+    if (provider->reserve) return btree_vd_s_create_a(meta_btree_alloc, (void *) provider);
+    meta_btree_share();
+    return btree_vd_s_create_shared((void *) provider);
+}
+
+static btree_ps_s *meta_btree_ps_s_create(const tbman_provider_s *provider) {
+    if (provider->reserve) return btree_ps_s_create_a(meta_btree_alloc, (void *) provider);
+    meta_btree_share();
+    return btree_ps_s_create_shared((void *) provider);
 }
 
 /**********************************************************************************************************************/
@@ -128,7 +846,19 @@ static void token_manager_s_down(token_manager_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static token_manager_s *token_manager_s_create(size_t pool_size, size_t block_size, bool align) {
+/// Marks all blocks free: the token stack holds all valid tokens in ascending order followed by zero-tokens
+static void token_manager_s_fill_stack(token_manager_s *o) {
+    size_t reserved_size = sizeof(token_manager_s) + sizeof(uint16_t) * o->stack_size;
+    size_t reserved_blocks = reserved_size / o->block_size + ((reserved_size % o->block_size) > 0);
+    o->stack_index = 0;
+    for (size_t i = 0; i < o->stack_size; i++)
+        o->token_stack[i] = (i + reserved_blocks) < o->stack_size ? (i + reserved_blocks) : 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static token_manager_s *
+token_manager_s_create(size_t pool_size, size_t block_size, bool align, const tbman_provider_s *provider) {
     if ((pool_size & (pool_size - 1)) != 0) ERR("pool_size %zu is not a power of two", pool_size);
     size_t stack_size = pool_size / block_size;
     if (stack_size > 0x10000) ERR("stack_size %zu exceeds 0x10000", stack_size);
@@ -136,32 +866,42 @@ static token_manager_s *token_manager_s_create(size_t pool_size, size_t block_si
     size_t reserved_blocks = reserved_size / block_size + ((reserved_size % block_size) > 0);
     if (stack_size < (reserved_blocks + 1)) ERR("pool_size %zu is too small", pool_size);
 
-    token_manager_s *o;
-    if (align) {
-        o = (token_manager_s *) _aligned_malloc(pool_size, pool_size);
-        if (!o) ERR("Failed aligned allocating %zu bytes", pool_size);
-    } else {
-        o = (token_manager_s *) _aligned_malloc(TBMAN_ALIGN, pool_size);
-        if (!o) ERR("Failed allocating %zu bytes", pool_size);
-    }
+    token_manager_s *o = (token_manager_s *) provider_reserve_aligned(provider, align ? pool_size : TBMAN_ALIGN, pool_size);
+    if (!o) ERR("Failed allocating %zu bytes", pool_size);
 
     token_manager_s_init(o);
     o->aligned = ((intptr_t) o & (intptr_t) (pool_size - 1)) == 0;
     o->pool_size = pool_size;
     o->block_size = block_size;
     o->stack_size = stack_size;
-    o->stack_index = 0;
-    for (size_t i = 0; i < o->stack_size; i++)
-        o->token_stack[i] = (i + reserved_blocks) < stack_size ? (i + reserved_blocks) : 0;
+    token_manager_s_fill_stack(o);
     return o;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void token_manager_s_discard(token_manager_s *o) {
+/** Marks all blocks free. (O(stack_size))
+ *  Freeing writes tokens back below the stack index in arbitrary order, overwriting the tokens stored there;
+ *  the stack is therefore rebuilt rather than only rewinding the stack index.
+ */
+static void token_manager_s_reset(token_manager_s *o) {
+    token_manager_s_fill_stack(o);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void token_manager_s_discard(token_manager_s *o, const tbman_provider_s *provider) {
     if (!o) return;
     token_manager_s_down(o);
-    _aligned_free(o);
+    provider_release(provider, o, o->pool_size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Decommits the blocks of an empty pool (header and token stack remain intact)
+static void token_manager_s_decommit(token_manager_s *o, const tbman_provider_s *provider) {
+    size_t reserved_size = sizeof(token_manager_s) + sizeof(uint16_t) * o->stack_size;
+    provider_decommit(provider, (uint8_t *) o + reserved_size, o->pool_size - reserved_size);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -216,6 +956,37 @@ static void token_manager_s_free(token_manager_s *o, void *ptr) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+/** Frees n blocks of this pool.
+ *  Reports turning full --> free but not turning empty; the caller handles emptied pools
+ *  (s. block_manager_s_empty_to_tail, block_manager_s_sweep).
+ */
+typedef struct free_batch_node {
+    void *ptr;
+    size_t size; // 0: unknown
+} free_batch_node;
+
+static void token_manager_s_free_batch(token_manager_s *o, const free_batch_node *nodes, size_t n) {
+    if (n > 0 && token_manager_s_is_full(o)) block_manager_s_full_to_free(o->parent, o);
+    for (size_t i = 0; i < n; i++) {
+#ifdef RTCHECKS
+        if( o->stack_index == 0 ) ERR( "Block manager is empty." );
+        if( ( size_t )( ( ptrdiff_t )( ( uint8_t* )nodes[ i ].ptr - ( uint8_t* )o ) ) > o->pool_size ) ERR( "Attempt to free memory outside pool." );
+#endif
+
+        uint16_t token = ((ptrdiff_t) ((uint8_t *) nodes[i].ptr - (uint8_t *) o)) / o->block_size;
+
+#ifdef RTCHECKS
+        if( token * o->block_size < sizeof( token_manager_s ) ) ERR( "Attempt to free reserved memory." );
+        for( size_t j = o->stack_index; j < o->stack_size; j++ ) if( o->token_stack[ j ] == token ) ERR( "Attempt to free memory that is declared free." );
+#endif // RTCHECKS
+
+        o->stack_index--;
+        o->token_stack[o->stack_index] = token;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 static size_t token_manager_s_total_alloc(const token_manager_s *o) {
     return o->block_size * o->stack_index;
 }
@@ -282,7 +1053,12 @@ static void print_token_manager_s_status(const token_manager_s *o, int detail_le
  *      with the last full token_manager and decrements free_index.
  *    - If a token-manager turns from free to empty, it reports to the block manager, which swaps its position
  *      with the last free token_manager. When enough empty token-managers accumulated (sweep_hysteresis), they
- *      are discarded (memory returned to the system).
+ *      are discarded (memory returned to the system) except for sweep_reserve empty token-managers.
+ *
+ *  Adaptive sweeping:
+ *    - A token-manager created within a short period (churn_window allocations) after a sweep discarded
+ *      token-managers counts as churn event. Each churn event doubles sweep_hysteresis and increments sweep_reserve.
+ *    - A sweep without token-managers created since the previous sweep relaxes both towards their defaults.
  *
  */
 typedef struct block_manager_s {
@@ -293,25 +1069,41 @@ typedef struct block_manager_s {
     size_t size, space;
     size_t free_index;       // entries equal or above free_index have space for allocation
     double sweep_hysteresis; // if ( empty token-managers ) / ( used token-managers ) < sweep_hysteresis, empty token-managers are discarded
+    size_t sweep_reserve;    // empty token-managers retained by sweeping
     bool aligned;          // all token managers are aligned to pool_size
     struct tbman_s *parent;
     btree_vd_s *internal_btree;
+    const tbman_provider_s *provider; // backing memory
+    bool maintained;         // empty token-managers are released by the maintenance thread (no sweeping)
+    bool active;             // allocations occurred since the last maintenance pass
+    size_t inline_pools;     // token-managers created by an allocating thread
+    size_t created_pools;    // token-managers created in total
+    size_t discarded_pools;  // token-managers discarded in total
+    size_t allocs;           // allocations in total (time base of churn detection)
+    size_t sweep_allocs;     // allocs at the last sweep discarding token-managers
+    size_t sweep_created;    // created_pools at the last sweep discarding token-managers
+    bool swept;              // token-managers were discarded by sweeping and none was created since
+    size_t churn_events;     // token-managers created shortly after a sweep discarded token-managers
 } block_manager_s;
 
+static const double default_sweep_hysteresis = 0.125;
+static const double max_sweep_hysteresis = 1.0;
+static const size_t max_sweep_reserve = 4;
+
 // ---------------------------------------------------------------------------------------------------------------------
 
 static void block_manager_s_init(block_manager_s *o) {
     memset(o, 0, sizeof(*o));
     o->aligned = true;
-    o->sweep_hysteresis = 0.125;
+    o->sweep_hysteresis = default_sweep_hysteresis;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
 static void block_manager_s_down(block_manager_s *o) {
     if (o->data) {
-        for (size_t i = 0; i < o->size; i++) token_manager_s_discard(o->data[i]);
-        free(o->data);
+        for (size_t i = 0; i < o->size; i++) token_manager_s_discard(o->data[i], o->provider);
+        meta_alloc(o->provider, o->data, 0);
         o->data = NULL;
         o->size = o->space = 0;
     }
@@ -319,13 +1111,14 @@ static void block_manager_s_down(block_manager_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static block_manager_s *block_manager_s_create(size_t pool_size, size_t block_size, bool align) {
-    block_manager_s *o = (block_manager_s *) malloc(sizeof(block_manager_s));
-    if (!o) ERR("Failed allocating %zu bytes", sizeof(block_manager_s));
+static block_manager_s *
+block_manager_s_create(size_t pool_size, size_t block_size, bool align, const tbman_provider_s *provider) {
+    block_manager_s *o = (block_manager_s *) meta_alloc(provider, NULL, sizeof(block_manager_s));
     block_manager_s_init(o);
     o->pool_size = pool_size;
     o->block_size = block_size;
     o->align = align;
+    o->provider = provider;
     return o;
 }
 
@@ -334,36 +1127,92 @@ static block_manager_s *block_manager_s_create(size_t pool_size, size_t block_si
 static void block_manager_s_discard(block_manager_s *o) {
     if (!o) return;
     block_manager_s_down(o);
-    free(o);
+    meta_alloc(o->provider, o, 0);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
 static void tbman_s_lost_alignment(struct tbman_s *o, const block_manager_s *child);
 
-static void *block_manager_s_alloc(block_manager_s *o) {
-    if (o->free_index == o->size) {
-        if (o->size == o->space) {
-            o->space = (o->space > 0) ? o->space * 2 : 1;
+static size_t block_manager_s_empty_tail(const block_manager_s *o);
 
-            if (o->data) {
-                o->data = (token_manager_s **) realloc(o->data, sizeof(token_manager_s *) * o->space);
-            } else {
-                o->data = (token_manager_s **) malloc(sizeof(token_manager_s *) * o->space);
-            }
+/// Appends an empty token-manager
+static void block_manager_s_push_empty(block_manager_s *o, token_manager_s *child) {
+    if (o->size == o->space) {
+        o->space = (o->space > 0) ? o->space * 2 : 1;
+        o->data = (token_manager_s **) meta_alloc(o->provider, o->data, sizeof(token_manager_s *) * o->space);
+    }
+    o->data[o->size] = child;
+    child->parent_index = o->size;
+    child->parent = o;
+    if (o->aligned && !child->aligned) {
+        o->aligned = false;
+        tbman_s_lost_alignment(o->parent, o);
+    }
+    if (btree_vd_s_set(o->internal_btree, child) != 1) ERR("Failed registering block address.");
+    o->size++;
+    o->created_pools++;
+}
 
-            if (!o->data) ERR("Failed allocating %zu bytes", sizeof(token_manager_s *) * o->space);
-        }
-        o->data[o->size] = token_manager_s_create(o->pool_size, o->block_size, o->align);
-        o->data[o->size]->parent_index = o->size;
-        o->data[o->size]->parent = o;
-        if (o->aligned && !o->data[o->size]->aligned) {
-            o->aligned = false;
-            tbman_s_lost_alignment(o->parent, o);
-        }
-        if (btree_vd_s_set(o->internal_btree, o->data[o->size]) != 1) ERR("Failed registering block address.");
-        o->size++;
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Detaches up to max_pools empty token-managers from the tail retaining at least keep_pools; returns number detached
+static size_t block_manager_s_pop_empty(block_manager_s *o, size_t keep_pools, token_manager_s **out, size_t max_pools) {
+    size_t empty_tail = block_manager_s_empty_tail(o);
+    size_t count = 0;
+    while (empty_tail > keep_pools && count < max_pools) {
+        o->size--;
+        empty_tail--;
+        if (btree_vd_s_remove(o->internal_btree, o->data[o->size]) != 1) ERR("Failed removing block address.");
+        out[count++] = o->data[o->size];
+        o->data[o->size] = NULL;
     }
+    o->discarded_pools += count;
+    return count;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Allocations after a sweep within which a new token-manager indicates churn
+static size_t block_manager_s_churn_window(const block_manager_s *o) {
+    return 4 * (o->pool_size / o->block_size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// A token-manager is needed: raises retention when it follows shortly after a sweep
+static void block_manager_s_adapt_up(block_manager_s *o) {
+    if (!o->swept) return;
+    o->swept = false;
+    if (o->allocs - o->sweep_allocs >= block_manager_s_churn_window(o)) return;
+    o->churn_events++;
+    o->sweep_hysteresis = min(o->sweep_hysteresis * 2, max_sweep_hysteresis);
+    o->sweep_reserve = min(o->sweep_reserve + 1, max_sweep_reserve);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Sweeping discards token-managers: relaxes retention when no token-manager was needed since the previous sweep
+static void block_manager_s_adapt_down(block_manager_s *o) {
+    if (o->created_pools == o->sweep_created) {
+        o->sweep_hysteresis = max(o->sweep_hysteresis * 0.5, default_sweep_hysteresis);
+        if (o->sweep_reserve > 0) o->sweep_reserve--;
+    }
+    o->sweep_created = o->created_pools;
+    o->sweep_allocs = o->allocs;
+    o->swept = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void *block_manager_s_alloc(block_manager_s *o) {
+    if (o->free_index == o->size) {
+        block_manager_s_adapt_up(o);
+        block_manager_s_push_empty(o, token_manager_s_create(o->pool_size, o->block_size, o->align, o->provider));
+        o->inline_pools++;
+    }
+    o->allocs++;
+    o->active = true;
     token_manager_s *child = o->data[o->free_index];
     void *ret = token_manager_s_alloc(child);
     if (token_manager_s_is_full(child)) o->free_index++;
@@ -372,6 +1221,28 @@ static void *block_manager_s_alloc(block_manager_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+/// Allocates n blocks into ptrs; tokens are popped in bulk from consecutive token-managers
+static void block_manager_s_alloc_batch(block_manager_s *o, size_t n, void **ptrs) {
+    size_t i = 0;
+    while (i < n) {
+        if (o->free_index == o->size) {
+            ptrs[i++] = block_manager_s_alloc(o); // appends a token-manager
+            continue;
+        }
+        token_manager_s *child = o->data[o->free_index];
+        uint8_t *pool = (uint8_t *) child;
+        size_t i0 = i;
+        while (i < n && !token_manager_s_is_full(child)) {
+            ptrs[i++] = pool + child->token_stack[child->stack_index++] * child->block_size;
+        }
+        o->allocs += i - i0;
+        o->active = true;
+        if (token_manager_s_is_full(child)) o->free_index++;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 // A child reports turning full --> free
 static void block_manager_s_full_to_free(block_manager_s *o, token_manager_s *child) {
     assert(o->free_index > 0);
@@ -400,9 +1271,8 @@ static size_t block_manager_s_empty_tail(const block_manager_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-// A child reports turning free --> empty
-static void block_manager_s_free_to_empty(block_manager_s *o, token_manager_s *child) {
-    // move empty manager to tail (if not already there)
+/// Moves an empty child to the empty tail (if not already there); returns the size of the empty tail
+static size_t block_manager_s_empty_to_tail(block_manager_s *o, token_manager_s *child) {
     size_t child_index = child->parent_index;
     size_t empty_tail = block_manager_s_empty_tail(o);
     if (empty_tail < o->size) {
@@ -416,10 +1286,19 @@ static void block_manager_s_free_to_empty(block_manager_s *o, token_manager_s *c
             empty_tail++;
         }
     }
+    return empty_tail;
+}
 
-    if (empty_tail > (o->size - empty_tail) * o->sweep_hysteresis) // discard empty managers when enough accumulated
-    {
-        while (o->size > 0 && token_manager_s_is_empty(o->data[o->size - 1])) {
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Discards the empty tail down to sweep_reserve when enough empty token-managers accumulated
+ *  (unless left to the maintenance thread)
+ */
+static void block_manager_s_sweep(block_manager_s *o, size_t empty_tail) {
+    if (o->maintained) return;
+    if (empty_tail > (o->size - empty_tail) * o->sweep_hysteresis + o->sweep_reserve) {
+        block_manager_s_adapt_down(o);
+        for (; empty_tail > o->sweep_reserve; empty_tail--) {
             o->size--;
 
             if (btree_vd_s_remove(o->internal_btree, o->data[o->size]) != 1) ERR("Failed removing block address.");
@@ -428,14 +1307,58 @@ static void block_manager_s_free_to_empty(block_manager_s *o, token_manager_s *c
             if( btree_vd_s_exists( o->internal_btree, o->data[ o->size ] ) )      ERR( "Removed block address still exists" );
 #endif
 
-            token_manager_s_discard(o->data[o->size]);
+            token_manager_s_discard(o->data[o->size], o->provider);
             o->data[o->size] = NULL;
+            o->discarded_pools++;
         }
     }
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+// A child reports turning free --> empty
+static void block_manager_s_free_to_empty(block_manager_s *o, token_manager_s *child) {
+    block_manager_s_sweep(o, block_manager_s_empty_to_tail(o, child));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Moves all empty children to the tail (O(size)); returns the size of the empty tail
+static size_t block_manager_s_gather_empty(block_manager_s *o) {
+    size_t used = o->free_index; // full children are below free_index
+    for (size_t i = o->free_index; i < o->size; i++) {
+        if (token_manager_s_is_empty(o->data[i])) continue;
+        token_manager_s *child = o->data[i];
+        o->data[i] = o->data[used];
+        o->data[used] = child;
+        o->data[i]->parent_index = i;
+        child->parent_index = used;
+        used++;
+    }
+    return o->size - used;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Marks all blocks free and retains at most keep_pools (empty) token-managers
+static void block_manager_s_reset(block_manager_s *o, size_t keep_pools) {
+    o->swept = false;
+    while (o->size > keep_pools) {
+        o->size--;
+        if (btree_vd_s_remove(o->internal_btree, o->data[o->size]) != 1) ERR("Failed removing block address.");
+        token_manager_s_discard(o->data[o->size], o->provider);
+        o->data[o->size] = NULL;
+        o->discarded_pools++;
+    }
+    for (size_t i = 0; i < o->size; i++) {
+        token_manager_s_reset(o->data[i]);
+        token_manager_s_decommit(o->data[i], o->provider);
+    }
+    o->free_index = 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 static size_t block_manager_s_total_alloc(const block_manager_s *o) {
     size_t sum = 0;
     for (size_t i = 0; i < o->size; i++) {
@@ -478,6 +1401,8 @@ static void print_block_manager_s_status(const block_manager_s *o, int detail_le
     printf("  pool_size:        %zu\n", o->pool_size);
     printf("  block_size:       %zu\n", o->block_size);
     printf("  sweep_hysteresis: %g\n", o->sweep_hysteresis);
+    printf("  sweep_reserve:    %zu\n", o->sweep_reserve);
+    printf("  churn_events:     %zu\n", o->churn_events);
     printf("  aligned:          %s\n", o->aligned ? "true" : "false");
     printf("  token_managers:   %zu\n", o->size);
     printf("      full:         %zu\n", o->free_index);
@@ -524,25 +1449,41 @@ typedef struct tbman_s {
     size_t *block_size_array;       // copy of block size values (for fast access)
     btree_vd_s *internal_btree;
     btree_ps_s *external_btree;
-    std::mutex mutex;
+    bool leak_warning;            // tbman_s_down reports leaking instances
+    region_s *region;             // memory region (NULL: memory obtained from provider)
+    tbman_provider_s provider;    // backing memory
+    void *root;                   // root object (s. tbman_s_set_root)
+    tbman_lock_s lock;
+    struct maintenance_s *maintenance;          // maintenance thread (NULL: not running)
+    mutex maintenance_control;                  // serializes starting/stopping the maintenance thread
+    tbman_maintenance_stats_s maintenance_stats; // guarded by lock
+    atomic<uintptr_t> deferred_head;            // instances pending free (s. tbman_s_free_deferred)
+    atomic<size_t> deferred_count;              // number of pending instances
+    atomic<size_t> deferred_limit;              // pending instances triggering a drain by the queuing thread (0: off)
+    atomic<bool> deferred_async;                // the maintenance thread drains the queue
 } tbman_s;
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void tbman_s_init(tbman_s *o, size_t pool_size, size_t min_block_size, size_t max_block_size, size_t stepping_method,
-                  bool full_align) {
+void tbman_s_init(tbman_s *o, const tbman_params_s *params, const tbman_provider_s *provider, region_s *region) {
     memset(o, 0, sizeof(*o));
     new(o) tbman_s{};
 
-    o->internal_btree = btree_vd_s_create(stdlib_alloc);
-    o->external_btree = btree_ps_s_create(stdlib_alloc);
+    o->region = region;
+    o->provider = *provider;
+    o->lock.policy = region ? TBMAN_LOCK_SPIN : params->lock_policy;
+    o->lock.shared = region != NULL;
+    o->lock.timing = params->lock_timing;
+    o->internal_btree = meta_btree_vd_s_create(&o->provider);
+    o->external_btree = meta_btree_ps_s_create(&o->provider);
+    o->leak_warning = true;
 
     /// The following three values are configurable parameters of memory manager
-    o->pool_size = pool_size;
-    o->min_block_size = min_block_size;
-    o->max_block_size = max_block_size;
+    o->pool_size = params->pool_size;
+    o->min_block_size = params->min_block_size;
+    o->max_block_size = params->max_block_size;
 
-    size_t mask_bxp = stepping_method;
+    size_t mask_bxp = params->stepping_method;
     size_t size_mask = (1 << mask_bxp) - 1;
     size_t size_inc = o->min_block_size;
     while ((size_mask < o->min_block_size) || ((size_mask << 1) & o->min_block_size) != 0) size_mask <<= 1;
@@ -552,16 +1493,9 @@ void tbman_s_init(tbman_s *o, size_t pool_size, size_t min_block_size, size_t ma
     for (size_t block_size = o->min_block_size; block_size <= o->max_block_size; block_size += size_inc) {
         if (o->size == space) {
             space = space > 0 ? space * 2 : 16;
-
-            if (o->data) {
-                o->data = (block_manager_s **) realloc(o->data, sizeof(block_manager_s *) * space);
-            } else {
-                o->data = (block_manager_s **) malloc(sizeof(block_manager_s *) * space);
-            }
-
-            if (!o->data) ERR("Failed allocating %zu bytes", sizeof(block_manager_s *) * space);
+            o->data = (block_manager_s **) meta_alloc(&o->provider, o->data, sizeof(block_manager_s *) * space);
         }
-        o->data[o->size] = block_manager_s_create(o->pool_size, block_size, full_align);
+        o->data[o->size] = block_manager_s_create(o->pool_size, block_size, params->full_align, &o->provider);
         o->data[o->size]->internal_btree = o->internal_btree;
         o->data[o->size]->parent = o;
         o->size++;
@@ -572,223 +1506,544 @@ void tbman_s_init(tbman_s *o, size_t pool_size, size_t min_block_size, size_t ma
         }
     }
 
-    o->block_size_array = (size_t *) malloc(o->size * sizeof(size_t));
-    if (!o->block_size_array) ERR("Failed allocating %zu bytes", o->size * sizeof(size_t));
+    o->block_size_array = (size_t *) meta_alloc(&o->provider, NULL, o->size * sizeof(size_t));
+
+    o->aligned = true;
+    for (size_t i = 0; i < o->size; i++) {
+        o->aligned = o->aligned && o->data[i]->aligned;
+        o->block_size_array[i] = o->data[i]->block_size;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_down(tbman_s *o) {
+    size_t leaking_bytes = o->leak_warning ? tbman_s_total_granted_space(o) : 0;
+
+    if (leaking_bytes > 0) {
+        size_t leaking_instances = tbman_s_total_instances(o);
+        fprintf
+                (
+                        stderr,
+                        "TBMAN WARNING: Detected %zu instances with a total of %zu bytes leaking space.\n",
+                        leaking_instances,
+                        leaking_bytes
+                );
+    }
+
+    lock_guard<tbman_lock_s> guard(o->lock);
+
+    if (o->data) {
+        for (size_t i = 0; i < o->size; i++) block_manager_s_discard(o->data[i]);
+        meta_alloc(&o->provider, o->data, 0);
+    }
+
+    btree_vd_s_discard(o->internal_btree);
+    btree_ps_s_discard(o->external_btree);
+
+    if (o->block_size_array) meta_alloc(&o->provider, o->block_size_array, 0);
+
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_params_s_init(tbman_params_s *o) {
+    memset(o, 0, sizeof(*o));
+    o->pool_size = default_pool_size;
+    o->min_block_size = default_min_block_size;
+    o->max_block_size = default_max_block_size;
+    o->stepping_method = default_stepping_method;
+    o->full_align = default_full_align;
+    o->lock_policy = TBMAN_DEFAULT_LOCK_POLICY;
+    o->lock_timing = TBMAN_DEFAULT_LOCK_TIMING;
+    o->provider = NULL;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Creates a manager obtaining its instance and all memory from 'provider'
+static tbman_s *tbman_s_create_from(const tbman_params_s *params, const tbman_provider_s *provider, region_s *region) {
+    tbman_s *o = (tbman_s *) provider_reserve(provider, sizeof(tbman_s));
+    if (!o) ERR("Failed allocating %zu bytes", sizeof(tbman_s));
+    tbman_s_init(o, params, provider, region);
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_s *tbman_s_create_with(const tbman_params_s *params) {
+    if (params->provider && (!params->provider->reserve || !params->provider->release))
+        ERR("Provider requires functions reserve and release.");
+    return tbman_s_create_from(params, params->provider ? params->provider : &provider_system, NULL);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_s *tbman_s_create
+        (
+                size_t pool_size,
+                size_t min_block_size,
+                size_t max_block_size,
+                size_t stepping_method,
+                bool full_align
+        ) {
+    tbman_params_s params;
+    tbman_params_s_init(&params);
+    params.pool_size = pool_size;
+    params.min_block_size = min_block_size;
+    params.max_block_size = max_block_size;
+    params.stepping_method = stepping_method;
+    params.full_align = full_align;
+    return tbman_s_create_with(&params);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_s *tbman_s_create_in_region
+        (
+                void *base,
+                size_t size,
+                size_t pool_size,
+                size_t min_block_size,
+                size_t max_block_size,
+                size_t stepping_method,
+                bool full_align
+        ) {
+    tbman_params_s params;
+    tbman_params_s_init(&params);
+    params.pool_size = pool_size;
+    params.min_block_size = min_block_size;
+    params.max_block_size = max_block_size;
+    params.stepping_method = stepping_method;
+    params.full_align = full_align;
+
+    region_s *region = region_s_create(base, size);
+    tbman_provider_s provider = region_s_provider(region);
+    tbman_s *o = tbman_s_create_from(&params, &provider, region);
+    region->manager = o;
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_s *tbman_s_attach_region(void *base) {
+    region_s *region = region_s_attach(base);
+    tbman_s *o = region->manager;
+    if (!o) ERR("Region at %p holds no manager", base);
+
+    // the region holds no process specific state; the calling process only needs to resolve shared btree allocations
+    meta_btree_share();
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t region_s_layout(void) {
+    return (sizeof(region_s) << 16) ^ (sizeof(tbman_s) << 8) ^ sizeof(token_manager_s) ^ (sizeof(block_manager_s) << 24) ^
+           ((size_t) REGION_VERSION << 40);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_s *tbman_s_create_default(void) {
+    return tbman_s_create
+            (
+                    default_pool_size,
+                    default_min_block_size,
+                    default_max_block_size,
+                    default_stepping_method,
+                    default_full_align
+            );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_discard(tbman_s *o) {
+    if (!o) return;
+    tbman_s_maintenance_stop(o);
+    tbman_s_flush_deferred(o);
+    region_s *region = o->region;
+    tbman_provider_s provider = o->provider;
+    tbman_s_down(o);
+    if (region) region->manager = NULL;
+    provider_release(&provider, o, sizeof(tbman_s));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_lock_stats_s tbman_s_lock_stats(tbman_s *o) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    return o->lock.stats;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_adopt(tbman_s *o) {
+#ifdef RTCHECKS
+    o->lock.owner = std::this_thread::get_id();
+#endif
+}
+
+/**********************************************************************************************************************/
+// Maintenance thread
+
+/** The maintenance thread moves pool creation and pool release off the allocating and freeing threads.
+ *  While it runs, block managers do not sweep; instead each pass trims every empty tail to reserve_pools
+ *  and tops it up again for block sizes in use. Only the detaching and appending of pools happens under the
+ *  manager's lock; pools are created and discarded outside.
+ */
+typedef struct maintenance_s {
+    thread worker;
+    mutex mtx;
+    condition_variable wake;
+    bool stop;
+    size_t reserve_pools;
+    size_t interval_us;
+} maintenance_s;
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static const size_t maintenance_batch = 16; // pools detached or appended per lock acquisition
+
+/// Runs one maintenance pass over all block managers
+static void tbman_s_maintain(tbman_s *o, size_t reserve_pools) {
+    token_manager_s *pools[maintenance_batch];
+    size_t provisioned = 0;
+    size_t released = 0;
+
+    tbman_s_flush_deferred(o);
+
+    for (size_t i = 0; i < o->size; i++) {
+        block_manager_s *block_manager = o->data[i];
+
+        // reserve target: classes in use (allocated since the last pass or holding used pools) keep reserve_pools
+        size_t target = 0;
+        {
+            lock_guard<tbman_lock_s> guard(o->lock);
+            bool in_use = block_manager->active || block_manager->size > block_manager_s_empty_tail(block_manager);
+            target = in_use ? reserve_pools : 0;
+        }
+
+        // release surplus
+        size_t missing = 0;
+        for (size_t count = maintenance_batch; count == maintenance_batch;) {
+            {
+                lock_guard<tbman_lock_s> guard(o->lock);
+                size_t empty_tail = block_manager_s_empty_tail(block_manager);
+                count = block_manager_s_pop_empty(block_manager, target, pools, maintenance_batch);
+                missing = (empty_tail < target) ? target - empty_tail : 0;
+            }
+            for (size_t j = 0; j < count; j++) token_manager_s_discard(pools[j], block_manager->provider);
+            released += count;
+        }
+
+        {
+            lock_guard<tbman_lock_s> guard(o->lock);
+            block_manager->active = false;
+        }
+
+        // provision reserve
+        while (missing > 0) {
+            size_t count = (missing < maintenance_batch) ? missing : maintenance_batch;
+            for (size_t j = 0; j < count; j++) {
+                pools[j] = token_manager_s_create(o->pool_size, block_manager->block_size, block_manager->align, block_manager->provider);
+            }
+            lock_guard<tbman_lock_s> guard(o->lock);
+            for (size_t j = 0; j < count; j++) block_manager_s_push_empty(block_manager, pools[j]);
+            provisioned += count;
+            missing -= count;
+        }
+    }
+
+    lock_guard<tbman_lock_s> guard(o->lock);
+    o->maintenance_stats.passes++;
+    o->maintenance_stats.pools_provisioned += provisioned;
+    o->maintenance_stats.pools_released += released;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void tbman_s_maintenance_run(tbman_s *o, maintenance_s *m) {
+    unique_lock<mutex> wait_lock(m->mtx);
+    while (!m->stop) {
+        size_t reserve_pools = m->reserve_pools;
+        wait_lock.unlock();
+        tbman_s_maintain(o, reserve_pools);
+        wait_lock.lock();
+        m->wake.wait_for(wait_lock, chrono::microseconds(m->interval_us), [m] { return m->stop; });
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_maintenance_start(tbman_s *o, size_t reserve_pools, size_t interval_us) {
+    if (o->region) ERR("Maintenance thread is not available for managers in a region.");
+    if (o->lock.policy == TBMAN_LOCK_NONE) ERR("Maintenance thread requires a locking manager.");
+
+    lock_guard<mutex> control(o->maintenance_control);
+    if (o->maintenance) {
+        maintenance_s *m = o->maintenance;
+        {
+            lock_guard<mutex> settings(m->mtx);
+            m->reserve_pools = reserve_pools;
+            m->interval_us = interval_us;
+        }
+        m->wake.notify_one();
+        return;
+    }
+
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        for (size_t i = 0; i < o->size; i++) o->data[i]->maintained = true;
+    }
+    o->deferred_async.store(true);
+
+    maintenance_s *m = new maintenance_s();
+    m->stop = false;
+    m->reserve_pools = reserve_pools;
+    m->interval_us = interval_us;
+    m->worker = thread(tbman_s_maintenance_run, o, m);
+    o->maintenance = m;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_maintenance_stop(tbman_s *o) {
+    lock_guard<mutex> control(o->maintenance_control);
+    maintenance_s *m = o->maintenance;
+    if (!m) return;
 
-    o->aligned = true;
+    {
+        lock_guard<mutex> settings(m->mtx);
+        m->stop = true;
+    }
+    m->wake.notify_one();
+    m->worker.join();
+    delete m;
+    o->maintenance = NULL;
+    o->deferred_async.store(false);
+    tbman_s_flush_deferred(o);
+
+    // freeing threads sweep again
+    lock_guard<tbman_lock_s> guard(o->lock);
     for (size_t i = 0; i < o->size; i++) {
-        o->aligned = o->aligned && o->data[i]->aligned;
-        o->block_size_array[i] = o->data[i]->block_size;
+        block_manager_s *block_manager = o->data[i];
+        block_manager->maintained = false;
+        block_manager_s_sweep(block_manager, block_manager_s_empty_tail(block_manager));
     }
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void tbman_s_down(tbman_s *o) {
-    size_t leaking_bytes = tbman_s_total_granted_space(o);
+tbman_maintenance_stats_s tbman_s_maintenance_stats(tbman_s *o) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    tbman_maintenance_stats_s stats = o->maintenance_stats;
+    stats.pools_inline = 0;
+    for (size_t i = 0; i < o->size; i++) stats.pools_inline += o->data[i]->inline_pools;
+    return stats;
+}
 
-    if (leaking_bytes > 0) {
-        size_t leaking_instances = tbman_s_total_instances(o);
-        fprintf
-                (
-                        stderr,
-                        "TBMAN WARNING: Detected %zu instances with a total of %zu bytes leaking space.\n",
-                        leaking_instances,
-                        leaking_bytes
-                );
-    }
+// ---------------------------------------------------------------------------------------------------------------------
 
-    lock_guard<mutex> guard(o->mutex);
-    if (o->data) {
-        for (size_t i = 0; i < o->size; i++) block_manager_s_discard(o->data[i]);
-        free(o->data);
+void tbman_s_set_leak_warning(tbman_s *o, bool flag) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    o->leak_warning = flag;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void tbman_s_ext_free(tbman_s *o, void *ptr, size_t size);
+
+static void ext_free(void *arg, btree_ps_key_t key, btree_ps_val_t val) { tbman_s_ext_free((tbman_s *) arg, key, val); }
+
+void tbman_s_reset(tbman_s *o, size_t keep_pools) {
+    // external blocks are detached under the lock and returned to the provider after unlocking
+    btree_ps_s *external_btree = meta_btree_ps_s_create(&o->provider);
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        o->deferred_head.store(0);
+        o->deferred_count.store(0);
+        for (size_t i = 0; i < o->size; i++) block_manager_s_reset(o->data[i], keep_pools);
+        swap(o->external_btree, external_btree);
     }
 
-    btree_vd_s_discard(o->internal_btree);
-    btree_ps_s_discard(o->external_btree);
+    btree_ps_s_run(external_btree, ext_free, o);
+    btree_ps_s_discard(external_btree);
+}
 
-    if (o->block_size_array) free(o->block_size_array);
+// ---------------------------------------------------------------------------------------------------------------------
 
+static void tbman_s_lost_alignment(struct tbman_s *o, const block_manager_s *child) {
+    o->aligned = false;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-tbman_s *tbman_s_create
-        (
-                size_t pool_size,
-                size_t min_block_size,
-                size_t max_block_size,
-                size_t stepping_method,
-                bool full_align
-        ) {
-    tbman_s *o = (tbman_s *) malloc(sizeof(tbman_s));
-    if (!o) ERR("Failed allocating %zu bytes", sizeof(tbman_s));
-    tbman_s_init(o, pool_size, min_block_size, max_block_size, stepping_method, full_align);
-    return o;
+/// Reserves an external block (size exceeding max_block_size)
+static void *tbman_s_ext_alloc(tbman_s *o, size_t size) {
+    void *ptr = provider_reserve_aligned(&o->provider, TBMAN_ALIGN, size);
+    if (!ptr) ERR("Failed allocating %zu bytes.", size);
+    return ptr;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-tbman_s *tbman_s_create_default(void) {
-    return tbman_s_create
-            (
-                    default_pool_size,
-                    default_min_block_size,
-                    default_max_block_size,
-                    default_stepping_method,
-                    default_full_align
-            );
+static void tbman_s_ext_free(tbman_s *o, void *ptr, size_t size) {
+    provider_release(&o->provider, ptr, size);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void tbman_s_discard(tbman_s *o) {
-    if (!o) return;
-    tbman_s_down(o);
-    free(o);
+/// Unregisters an external block; returns its size
+static size_t tbman_s_ext_unregister(tbman_s *o, void *ptr) {
+    size_t *p_size = btree_ps_s_val(o->external_btree, ptr);
+    if (!p_size) ERR("Attempt to free invalid memory");
+    size_t size = *p_size;
+    if (btree_ps_s_remove(o->external_btree, ptr) != 1) ERR("Attempt to free invalid memory");
+    return size;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void tbman_s_lost_alignment(struct tbman_s *o, const block_manager_s *child) {
-    o->aligned = false;
+/// Returns the index of the block manager serving requested_size; o->size when requested_size exceeds max_block_size
+static size_t tbman_s_class_of(const tbman_s *o, size_t requested_size) {
+    if (requested_size > o->max_block_size) return o->size;
+    size_t i = 0;
+    while (i < o->size && requested_size > o->block_size_array[i]) i++;
+    return i;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void *tbman_s_mem_alloc(tbman_s *o, size_t requested_size, size_t *granted_size) {
-    block_manager_s *block_manager = NULL;
-    for (size_t i = 0; i < o->size; i++) {
-        if (requested_size <= o->block_size_array[i]) {
-            block_manager = o->data[i];
-            break;
-        }
+/// Returns the token manager owning current_ptr; NULL in case current_ptr is external memory
+static token_manager_s *tbman_s_token_manager_of(const tbman_s *o, const void *current_ptr, const size_t *current_size) {
+    if (current_size && *current_size <= o->max_block_size && o->aligned) {
+        return (token_manager_s *) ((intptr_t) current_ptr & ~(intptr_t) (o->pool_size - 1));
+    } else {
+        void *block_ptr = btree_vd_s_largest_below_equal(o->internal_btree, (void *) current_ptr);
+        if (block_ptr && (((uint8_t *) current_ptr - (uint8_t *) block_ptr) < o->pool_size))
+            return (token_manager_s *) block_ptr;
     }
+    return NULL;
+}
 
-    void *reserved_ptr = NULL;
-    if (block_manager) {
-        reserved_ptr = block_manager_s_alloc(block_manager);
-        if (granted_size) *granted_size = block_manager->block_size;
-    } else {
-        reserved_ptr = _aligned_malloc(TBMAN_ALIGN, requested_size);
-        if (!reserved_ptr) ERR("Failed allocating %zu bytes.", requested_size);
-        if (granted_size) *granted_size = requested_size;
-        if (btree_ps_s_set(o->external_btree, reserved_ptr, requested_size) != 1) ERR("Registering new address failed");
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Allocation, free and realloc acquiring the lock as needed.
+ *  Copying and provider calls (system calls) are done outside the lock; only metadata updates are locked.
+ *  An instance being reallocated or freed is owned by the caller, hence its state (token-manager, external size)
+ *  remains valid while the lock is released.
+ */
+static void *tbman_s_do_alloc(tbman_s *o, size_t requested_size, size_t *granted_size) {
+    size_t class_index = tbman_s_class_of(o, requested_size);
+    if (class_index < o->size) {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        if (granted_size) *granted_size = o->block_size_array[class_index];
+        return block_manager_s_alloc(o->data[class_index]);
     }
 
+    void *reserved_ptr = tbman_s_ext_alloc(o, requested_size);
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        if (btree_ps_s_set(o->external_btree, reserved_ptr, requested_size) != 1) ERR("Registering new address failed");
+    }
+    if (granted_size) *granted_size = requested_size;
     return reserved_ptr;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void tbman_s_mem_free(tbman_s *o, void *current_ptr, const size_t *current_size) {
-    if (current_size && *current_size <= o->max_block_size && o->aligned) {
-        token_manager_s *token_manager = (token_manager_s *) ((intptr_t) current_ptr & ~(intptr_t) (o->pool_size - 1));
-        token_manager_s_free(token_manager, current_ptr);
-    } else {
-        void *block_ptr = btree_vd_s_largest_below_equal(o->internal_btree, current_ptr);
-        if (block_ptr && (((uint8_t *) current_ptr - (uint8_t *) block_ptr) < o->pool_size)) {
-            token_manager_s_free((token_manager_s *) block_ptr, current_ptr);
-        } else {
-            if (btree_ps_s_remove(o->external_btree, current_ptr) != 1) ERR("Attempt to free invalid memory");
-            free(current_ptr);
+static void tbman_s_do_free(tbman_s *o, void *current_ptr, const size_t *current_size) {
+    size_t ext_size = 0;
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        token_manager_s *token_manager = tbman_s_token_manager_of(o, current_ptr, current_size);
+        if (token_manager) {
+            token_manager_s_free(token_manager, current_ptr);
+            return;
         }
+        ext_size = tbman_s_ext_unregister(o, current_ptr);
     }
+    tbman_s_ext_free(o, current_ptr, ext_size);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void *tbman_s_mem_realloc(tbman_s *o, void *current_ptr, const size_t *current_size, size_t requested_size,
-                                 size_t *granted_size) {
+static void *tbman_s_do_realloc(tbman_s *o, void *current_ptr, const size_t *current_size, size_t requested_size,
+                                size_t *granted_size) {
+    size_t class_index = tbman_s_class_of(o, requested_size);
     token_manager_s *token_manager = NULL;
-    if (current_size && *current_size <= o->max_block_size && o->aligned) {
-        token_manager = (token_manager_s *) ((intptr_t) current_ptr & ~(intptr_t) (o->pool_size - 1));
-    } else {
-        void *block_ptr = btree_vd_s_largest_below_equal(o->internal_btree, current_ptr);
-        if (block_ptr && (((uint8_t *) current_ptr - (uint8_t *) block_ptr) < o->pool_size))
-            token_manager = (token_manager_s *) block_ptr;
-    }
-
-    if (token_manager) {
-        if (requested_size > token_manager->block_size) {
-            void *reserved_ptr = tbman_s_mem_alloc(o, requested_size, granted_size);
-            memcpy(reserved_ptr, current_ptr, token_manager->block_size);
-            token_manager_s_free(token_manager, current_ptr);
-            return reserved_ptr;
-        } else // size reduction
-        {
-            block_manager_s *block_manager = NULL;
-            for (size_t i = 0; i < o->size; i++) {
-                if (requested_size <= o->block_size_array[i]) {
-                    block_manager = o->data[i];
-                    break;
-                }
-            }
+    size_t current_space = 0;
+    void *reserved_ptr = NULL;
+    size_t reserved_space = requested_size;
+    bool keep = false;
 
-            if (block_manager->block_size != token_manager->block_size) {
-                void *reserved_ptr = block_manager_s_alloc(block_manager);
-                memcpy(reserved_ptr, current_ptr, requested_size);
-                token_manager_s_free(token_manager, current_ptr);
-                if (granted_size) *granted_size = block_manager->block_size;
-                return reserved_ptr;
-            } else {
-                // same block-size: keep current location
-                if (granted_size) *granted_size = token_manager->block_size;
-                return current_ptr;
-            }
-        }
-    } else {
-        if (requested_size <= o->max_block_size) // new size fits into manager, old size was outside manager
-        {
-            void *reserved_ptr = tbman_s_mem_alloc(o, requested_size, granted_size);
-            memcpy(reserved_ptr, current_ptr, requested_size);
-            if (btree_ps_s_remove(o->external_btree, current_ptr) != 1) ERR("Attempt to free invalid memory");
-            free(current_ptr);
-            return reserved_ptr;
-        } else // neither old nor new size handled by this manager
-        {
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        token_manager = tbman_s_token_manager_of(o, current_ptr, current_size);
+        if (token_manager) {
+            current_space = token_manager->block_size;
+        } else {
             size_t *p_current_size = btree_ps_s_val(o->external_btree, current_ptr);
             if (!p_current_size) ERR("Could not retrieve current external memory");
-            size_t current_ext_bytes = *p_current_size;
+            current_space = *p_current_size;
+        }
 
-            // is requested bytes is less but not significantly less than current bytes, keep current memory
-            if ((requested_size < current_ext_bytes) && (requested_size >= (current_ext_bytes >> 1))) {
-                if (granted_size) *granted_size = current_ext_bytes;
-                return current_ptr;
+        if (class_index < o->size) {
+            // same block-size: keep current location
+            keep = token_manager && current_space == o->block_size_array[class_index];
+            if (!keep) {
+                reserved_ptr = block_manager_s_alloc(o->data[class_index]);
+                reserved_space = o->block_size_array[class_index];
             }
+        } else {
+            // is requested bytes is less but not significantly less than current bytes, keep current memory
+            keep = !token_manager && requested_size <= current_space && requested_size >= (current_space >> 1);
+        }
+    }
 
-            void *reserved_ptr = _aligned_malloc(TBMAN_ALIGN, requested_size);
-            if (!reserved_ptr) ERR("Failed allocating %zu bytes.", requested_size);
-            if (granted_size) *granted_size = requested_size;
-            if (btree_ps_s_set(o->external_btree, reserved_ptr, requested_size) != 1)
-                ERR("Registering new address failed");
+    if (keep) {
+        if (!token_manager && requested_size < current_space) {
+            provider_decommit(&o->provider, (uint8_t *) current_ptr + requested_size, current_space - requested_size);
+        }
+        if (granted_size) *granted_size = current_space;
+        return current_ptr;
+    }
 
-            size_t copy_bytes = (requested_size < current_ext_bytes) ? requested_size : current_ext_bytes;
-            memcpy(reserved_ptr, current_ptr, copy_bytes);
+    if (!reserved_ptr) reserved_ptr = tbman_s_ext_alloc(o, requested_size);
+    memcpy(reserved_ptr, current_ptr, requested_size < current_space ? requested_size : current_space);
 
-            if (btree_ps_s_remove(o->external_btree, current_ptr) != 1) ERR("Attempt to free invalid memory");
-            free(current_ptr);
-            return reserved_ptr;
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        if (class_index == o->size && btree_ps_s_set(o->external_btree, reserved_ptr, requested_size) != 1) {
+            ERR("Registering new address failed");
+        }
+        if (token_manager) {
+            token_manager_s_free(token_manager, current_ptr);
+        } else {
+            tbman_s_ext_unregister(o, current_ptr);
         }
     }
+
+    if (!token_manager) tbman_s_ext_free(o, current_ptr, current_space);
+    if (granted_size) *granted_size = reserved_space;
+    return reserved_ptr;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
 void *tbman_s_alloc(tbman_s *o, void *current_ptr, size_t requested_size, size_t *granted_size) {
-    lock_guard<mutex> guard(o->mutex);
-
     void *ret = NULL;
     if (requested_size == 0) {
         if (current_ptr) {
-            tbman_s_mem_free(o, current_ptr, NULL);
+            tbman_s_do_free(o, current_ptr, NULL);
         }
         if (granted_size) *granted_size = 0;
     } else {
         if (current_ptr) {
-            ret = tbman_s_mem_realloc(o, current_ptr, NULL, requested_size, granted_size);
+            ret = tbman_s_do_realloc(o, current_ptr, NULL, requested_size, granted_size);
         } else {
-            ret = tbman_s_mem_alloc(o, requested_size, granted_size);
+            ret = tbman_s_do_alloc(o, requested_size, granted_size);
         }
     }
     return ret;
@@ -797,20 +2052,19 @@ void *tbman_s_alloc(tbman_s *o, void *current_ptr, size_t requested_size, size_t
 // ---------------------------------------------------------------------------------------------------------------------
 
 void *tbman_s_nalloc(tbman_s *o, void *current_ptr, size_t current_size, size_t requested_size, size_t *granted_size) {
-    lock_guard<mutex> guard(o->mutex);
     void *ret = NULL;
     if (requested_size == 0) {
         if (current_size) // 0 means current_ptr may not be used for free or realloc
         {
-            tbman_s_mem_free(o, current_ptr, &current_size);
+            tbman_s_do_free(o, current_ptr, &current_size);
         }
         if (granted_size) *granted_size = 0;
     } else {
         if (current_size) // 0 means current_ptr may not be used for free or realloc
         {
-            ret = tbman_s_mem_realloc(o, current_ptr, &current_size, requested_size, granted_size);
+            ret = tbman_s_do_realloc(o, current_ptr, &current_size, requested_size, granted_size);
         } else {
-            ret = tbman_s_mem_alloc(o, requested_size, granted_size);
+            ret = tbman_s_do_alloc(o, requested_size, granted_size);
         }
     }
     return ret;
@@ -818,6 +2072,208 @@ void *tbman_s_nalloc(tbman_s *o, void *current_ptr, size_t current_size, size_t
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+size_t tbman_s_alloc_batch(tbman_s *o, size_t requested_size, size_t n, void **ptrs) {
+    size_t class_index = tbman_s_class_of(o, requested_size);
+    if (class_index < o->size) {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        block_manager_s_alloc_batch(o->data[class_index], n, ptrs);
+        return o->block_size_array[class_index];
+    }
+
+    // external blocks are reserved outside the lock and registered at once
+    for (size_t i = 0; i < n; i++) ptrs[i] = tbman_s_ext_alloc(o, requested_size);
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        for (size_t i = 0; i < n; i++) {
+            if (btree_ps_s_set(o->external_btree, ptrs[i], requested_size) != 1) ERR("Registering new address failed");
+        }
+    }
+    return requested_size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Frees the instances in nodes[0 ... size - 1]; 'sized': sizes are given (a size of 0 means unknown).
+ *  The nodes are reordered and overwritten. 'emptied' is scratch space for up to 'size' class indices.
+ *  Needs no heap memory of its own, hence also serves draining deferred frees (s. tbman_s_flush_deferred).
+ */
+static void tbman_s_free_nodes(tbman_s *o, free_batch_node *nodes, size_t size, bool sized, size_t *emptied) {
+    /** Without sizes, a token-manager lookup requires the btree. Sorting by address (outside the lock) then groups
+     *  instances by pool (a pool is a contiguous range) so that only the first instance of a group needs a lookup.
+     *  With sizes, the lookup is O(1) while all token managers are aligned and sorting does not pay off.
+     */
+    if (!sized || !o->aligned) {
+        sort(nodes, nodes + size, [](const free_batch_node &a, const free_batch_node &b) { return a.ptr < b.ptr; });
+    }
+
+    size_t ext_size = 0;     // external blocks: unregistered under the lock, collected in nodes[0 ... ext_size - 1]
+    size_t emptied_size = 0; // distinct classes holding emptied pools
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+
+        for (size_t i = 0; i < size;) {
+            token_manager_s *token_manager = tbman_s_token_manager_of(o, nodes[i].ptr, nodes[i].size ? &nodes[i].size : NULL);
+            if (!token_manager) {
+                void *ptr = nodes[i++].ptr;
+                nodes[ext_size++] = {ptr, tbman_s_ext_unregister(o, ptr)};
+                continue;
+            }
+
+            size_t j = i + 1;
+            while (j < size && (size_t) ((uint8_t *) nodes[j].ptr - (uint8_t *) token_manager) < o->pool_size) j++;
+            token_manager_s_free_batch(token_manager, nodes + i, j - i);
+            if (token_manager_s_is_empty(token_manager)) {
+                size_t class_index = tbman_s_class_of(o, token_manager->block_size);
+                size_t k = 0;
+                while (k < emptied_size && emptied[k] != class_index) k++;
+                if (k == emptied_size) emptied[emptied_size++] = class_index;
+            }
+            i = j;
+        }
+
+        // sweeping emptied pools is deferred to the end
+        for (size_t k = 0; k < emptied_size; k++) {
+            block_manager_s *block_manager = o->data[emptied[k]];
+            block_manager_s_sweep(block_manager, block_manager_s_gather_empty(block_manager));
+        }
+    }
+
+    for (size_t i = 0; i < ext_size; i++) tbman_s_ext_free(o, nodes[i].ptr, nodes[i].size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_free_batch(tbman_s *o, void *const *ptrs, const size_t *sizes, size_t n) {
+    if (n == 0) return;
+    free_batch_node *nodes = (free_batch_node *) malloc(sizeof(free_batch_node) * n);
+    size_t *emptied = (size_t *) malloc(sizeof(size_t) * n);
+    if (!nodes) ERR("Failed allocating %zu bytes", sizeof(free_batch_node) * n);
+    if (!emptied) ERR("Failed allocating %zu bytes", sizeof(size_t) * n);
+
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ptrs[i]) nodes[size++] = {ptrs[i], sizes ? sizes[i] : 0};
+    }
+    tbman_s_free_nodes(o, nodes, size, sizes != NULL, emptied);
+
+    free(emptied);
+    free(nodes);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Pending instances form a singly linked stack through their own memory: The first word holds the link to the
+ *  next instance; bit 0 of a link indicates that the linked instance holds its size in the second word.
+ *  Queuing is a CAS-push; draining detaches the whole stack at once (no ABA problem).
+ */
+static const uintptr_t deferred_sized = 1;
+static const size_t deferred_batch = 256; // instances per tbman_s_free_nodes while draining (on-stack scratch)
+
+void tbman_s_free_deferred(tbman_s *o, void *current_ptr, size_t current_size) {
+    if (!current_ptr) return;
+    if (o->min_block_size < sizeof(uintptr_t)) ERR("Deferred freeing requires min_block_size >= %zu.", sizeof(uintptr_t));
+
+    uintptr_t link = (uintptr_t) current_ptr;
+    if (current_size >= sizeof(uintptr_t) + sizeof(size_t)) {
+        memcpy((uint8_t *) current_ptr + sizeof(uintptr_t), &current_size, sizeof(size_t));
+        link |= deferred_sized;
+    }
+
+    // counted before publishing: a concurrent drain subtracts only counted instances (the count cannot wrap)
+    size_t count = o->deferred_count.fetch_add(1, memory_order_relaxed) + 1;
+    uintptr_t head = o->deferred_head.load(memory_order_relaxed);
+    do {
+        memcpy(current_ptr, &head, sizeof(uintptr_t));
+    } while (!o->deferred_head.compare_exchange_weak(head, link, memory_order_release, memory_order_relaxed));
+
+    size_t limit = o->deferred_limit.load(memory_order_relaxed);
+    if (limit > 0 && count >= limit && !o->deferred_async.load(memory_order_relaxed)) tbman_s_flush_deferred(o);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_s_flush_deferred(tbman_s *o) {
+    uintptr_t link = o->deferred_head.exchange(0, memory_order_acquire);
+    free_batch_node nodes[deferred_batch];
+    size_t emptied[deferred_batch];
+    size_t n = 0;
+    size_t total = 0;
+
+    while (link) {
+        void *ptr = (void *) (link & ~deferred_sized);
+        size_t size = 0;
+        if (link & deferred_sized) memcpy(&size, (uint8_t *) ptr + sizeof(uintptr_t), sizeof(size_t));
+        memcpy(&link, ptr, sizeof(uintptr_t));
+        nodes[n++] = {ptr, size};
+        if (n == deferred_batch) {
+            tbman_s_free_nodes(o, nodes, n, true, emptied);
+            total += n;
+            n = 0;
+        }
+    }
+    tbman_s_free_nodes(o, nodes, n, true, emptied);
+    total += n;
+
+    o->deferred_count.fetch_sub(total, memory_order_relaxed);
+    return total;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_set_deferred_limit(tbman_s *o, size_t limit) {
+    o->deferred_limit.store(limit);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+bool tbman_s_expand(tbman_s *o, void *current_ptr, size_t current_size, size_t min_size, size_t max_size,
+                    size_t *granted_size) {
+    if (max_size < min_size) max_size = min_size;
+
+    size_t space = 0;
+    bool external = false;
+    {
+        lock_guard<tbman_lock_s> guard(o->lock);
+        token_manager_s *token_manager = tbman_s_token_manager_of(o, current_ptr, current_size ? &current_size : NULL);
+        if (token_manager) {
+            // blocks of a pool have a fixed size
+            space = token_manager->block_size;
+        } else {
+            size_t *p_current_size = btree_ps_s_val(o->external_btree, current_ptr);
+            if (!p_current_size) ERR("Attempt to expand invalid memory");
+            space = *p_current_size;
+            external = true;
+        }
+    }
+
+    // external block: the provider expands outside the lock (the caller owns the instance; s. tbman_s_do_alloc)
+    if (space < min_size && external) {
+        space = provider_expand(&o->provider, current_ptr, space, min_size, max_size);
+        if (space < min_size) return false;
+        lock_guard<tbman_lock_s> guard(o->lock);
+        *btree_ps_s_val(o->external_btree, current_ptr) = space;
+    }
+    if (space < min_size) return false;
+
+    if (granted_size) *granted_size = space;
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_s_good_size(const tbman_s *o, size_t requested_size, size_t *class_index) {
+    // block sizes are constant after creation: no locking required
+    size_t index = tbman_s_class_of(o, requested_size);
+    if (index < o->size) {
+        if (class_index) *class_index = index;
+        return o->block_size_array[index];
+    }
+    if (class_index) *class_index = TBMAN_CLASS_EXTERNAL;
+    return requested_size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 static size_t tbman_s_external_total_alloc(const tbman_s *o) {
     return btree_ps_s_sum(o->external_btree, NULL, NULL);
 }
@@ -887,7 +2343,7 @@ static size_t tbman_s_total_alloc(const tbman_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static size_t tbman_s_total_space(const tbman_s *o) {
+static size_t tbman_s_internal_total_space(const tbman_s *o) {
     size_t sum = 0;
     for (size_t i = 0; i < o->size; i++) {
         sum += block_manager_s_total_space(o->data[i]);
@@ -897,72 +2353,129 @@ static size_t tbman_s_total_space(const tbman_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-/**********************************************************************************************************************/
-// Interface
+/**********************************************************************************************************************/
+// Interface
+
+static tbman_s *tbman_s_g = NULL;
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void create_tbman() {
+    tbman_s_g = tbman_s_create
+            (
+                    default_pool_size,
+                    default_min_block_size,
+                    default_max_block_size,
+                    default_stepping_method,
+                    default_full_align
+            );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void discard_tbman() {
+    tbman_s_discard(tbman_s_g);
+    tbman_s_g = NULL;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_open(void) {
+    static once_flag flag;
+    try {
+        call_once(flag, create_tbman);
+    } catch (exception &e) {
+        ERR("function returned error %i", e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_close(void) {
+    discard_tbman();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void *tbman_alloc(void *current_ptr, size_t requested_size, size_t *granted_size) {
+    ASSERT_GLOBAL_INITIALIZED();
+    return tbman_s_alloc(tbman_s_g, current_ptr, requested_size, granted_size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void *tbman_nalloc(void *current_ptr, size_t current_size, size_t requested_size, size_t *granted_size) {
+    ASSERT_GLOBAL_INITIALIZED();
+    return tbman_s_nalloc(tbman_s_g, current_ptr, current_size, requested_size, granted_size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_alloc_batch(size_t requested_size, size_t n, void **ptrs) {
+    ASSERT_GLOBAL_INITIALIZED();
+    return tbman_s_alloc_batch(tbman_s_g, requested_size, n, ptrs);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_free_batch(void *const *ptrs, const size_t *sizes, size_t n) {
+    ASSERT_GLOBAL_INITIALIZED();
+    tbman_s_free_batch(tbman_s_g, ptrs, sizes, n);
+}
 
-static tbman_s *tbman_s_g = NULL;
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_free_deferred(void *current_ptr, size_t current_size) {
+    ASSERT_GLOBAL_INITIALIZED();
+    tbman_s_free_deferred(tbman_s_g, current_ptr, current_size);
+}
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void create_tbman() {
-    tbman_s_g = tbman_s_create
-            (
-                    default_pool_size,
-                    default_min_block_size,
-                    default_max_block_size,
-                    default_stepping_method,
-                    default_full_align
-            );
+size_t tbman_flush_deferred(void) {
+    ASSERT_GLOBAL_INITIALIZED();
+    return tbman_s_flush_deferred(tbman_s_g);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-static void discard_tbman() {
-    tbman_s_discard(tbman_s_g);
-    tbman_s_g = NULL;
+void tbman_maintenance_start(size_t reserve_pools, size_t interval_us) {
+    ASSERT_GLOBAL_INITIALIZED();
+    tbman_s_maintenance_start(tbman_s_g, reserve_pools, interval_us);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void tbman_open(void) {
-    static once_flag flag;
-    try {
-        call_once(flag, create_tbman);
-    } catch (exception &e) {
-        ERR("function returned error %i", e.what());
-    }
+void tbman_maintenance_stop(void) {
+    ASSERT_GLOBAL_INITIALIZED();
+    tbman_s_maintenance_stop(tbman_s_g);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void tbman_close(void) {
-    discard_tbman();
+tbman_maintenance_stats_s tbman_maintenance_stats(void) {
+    ASSERT_GLOBAL_INITIALIZED();
+    return tbman_s_maintenance_stats(tbman_s_g);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void *tbman_alloc(void *current_ptr, size_t requested_size, size_t *granted_size) {
+bool tbman_expand(void *current_ptr, size_t current_size, size_t min_size, size_t max_size, size_t *granted_size) {
     ASSERT_GLOBAL_INITIALIZED();
-    return tbman_s_alloc(tbman_s_g, current_ptr, requested_size, granted_size);
+    return tbman_s_expand(tbman_s_g, current_ptr, current_size, min_size, max_size, granted_size);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
-void *tbman_nalloc(void *current_ptr, size_t current_size, size_t requested_size, size_t *granted_size) {
+size_t tbman_good_size(size_t requested_size, size_t *class_index) {
     ASSERT_GLOBAL_INITIALIZED();
-    return tbman_s_nalloc(tbman_s_g, current_ptr, current_size, requested_size, granted_size);
+    return tbman_s_good_size(tbman_s_g, requested_size, class_index);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
 size_t tbman_s_granted_space(tbman_s *o, const void *current_ptr) {
-    token_manager_s *token_manager = NULL;
-    {
-        void *block_ptr = btree_vd_s_largest_below_equal(o->internal_btree, (void *) current_ptr);
-        if (block_ptr && (((uint8_t *) current_ptr - (uint8_t *) block_ptr) < o->pool_size))
-            token_manager = (token_manager_s *) block_ptr;
-    }
-
+    token_manager_s *token_manager = tbman_s_token_manager_of(o, current_ptr, NULL);
     if (token_manager) {
         return token_manager->block_size;
     } else {
@@ -982,13 +2495,20 @@ size_t tbman_granted_space(const void *current_ptr) {
 // ---------------------------------------------------------------------------------------------------------------------
 
 size_t tbman_s_total_granted_space(tbman_s *o) {
-    lock_guard<mutex> guard(o->mutex);
+    lock_guard<tbman_lock_s> guard(o->lock);
     size_t space = tbman_s_total_alloc(o);
     return space;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+size_t tbman_s_total_space(tbman_s *o) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    return tbman_s_internal_total_space(o) + tbman_s_external_total_alloc(o);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 size_t tbman_total_granted_space(void) {
     ASSERT_GLOBAL_INITIALIZED();
     return tbman_s_total_granted_space(tbman_s_g);
@@ -996,6 +2516,13 @@ size_t tbman_total_granted_space(void) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+size_t tbman_total_space(void) {
+    ASSERT_GLOBAL_INITIALIZED();
+    return tbman_s_total_space(tbman_s_g);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 size_t tbman_total_instances(void) {
     ASSERT_GLOBAL_INITIALIZED();
     return tbman_s_total_instances(tbman_s_g);
@@ -1004,7 +2531,7 @@ size_t tbman_total_instances(void) {
 // ---------------------------------------------------------------------------------------------------------------------
 
 size_t tbman_s_total_instances(tbman_s *o) {
-    lock_guard<mutex> guard(o->mutex);
+    lock_guard<tbman_lock_s> guard(o->lock);
     size_t count = 0;
     count += tbman_s_external_total_instances(o);
     count += tbman_s_internal_total_instances(o);
@@ -1013,6 +2540,32 @@ size_t tbman_s_total_instances(tbman_s *o) {
 
 // ---------------------------------------------------------------------------------------------------------------------
 
+size_t tbman_s_classes(tbman_s *o) {
+    return o->size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_class_stats_s tbman_s_class_stats(tbman_s *o, size_t class_index) {
+    if (class_index >= o->size) ERR("Class index %zu out of range (%zu classes).", class_index, o->size);
+    lock_guard<tbman_lock_s> guard(o->lock);
+    const block_manager_s *block_manager = o->data[class_index];
+    tbman_class_stats_s stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.block_size = block_manager->block_size;
+    stats.pools = block_manager->size;
+    for (size_t i = 0; i < block_manager->size; i++) stats.empty_pools += token_manager_s_is_empty(block_manager->data[i]);
+    stats.instances = block_manager_s_total_instances(block_manager);
+    stats.pools_created = block_manager->created_pools;
+    stats.pools_discarded = block_manager->discarded_pools;
+    stats.churn_events = block_manager->churn_events;
+    stats.sweep_hysteresis = block_manager->sweep_hysteresis;
+    stats.sweep_reserve = block_manager->sweep_reserve;
+    return stats;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
 typedef struct tbman_mnode {
     void *p;
     size_t s;
@@ -1042,7 +2595,7 @@ void tbman_s_for_each_instance(tbman_s *o, void (*cb)(void *arg, void *ptr, size
     arr.size = 0;
 
     {
-        lock_guard<mutex> guard(o->mutex);
+        lock_guard<tbman_lock_s> guard(o->lock);
         tbman_s_external_for_each_instance(o, for_each_instance_collect_callback, &arr);
         tbman_s_internal_for_each_instance(o, for_each_instance_collect_callback, &arr);
     }
@@ -1077,7 +2630,7 @@ void print_tbman_s_status(tbman_s *o, int detail_level) {
     printf("aligned:                %s\n", o->aligned ? "true" : "false");
     printf("total external granted: %zu\n", tbman_s_external_total_alloc(o));
     printf("total internal granted: %zu\n", tbman_s_internal_total_alloc(o));
-    printf("total internal used:    %zu\n", tbman_s_total_space(o));
+    printf("total internal used:    %zu\n", tbman_s_internal_total_space(o));
     if (detail_level > 1) {
         for (size_t i = 0; i < o->size; i++) {
             printf("\nblock manager %zu:\n", i);
@@ -1093,3 +2646,473 @@ void print_tbman_status(int detail_level) {
 }
 
 /**********************************************************************************************************************/
+/**********************************************************************************************************************/
+/** Arena
+ *
+ *  Bump-pointer allocation from chunks obtained from a parent manager.
+ *  An alloc request advances a position pointer inside the current chunk; when the chunk is exhausted,
+ *  a new chunk is requested from the parent. Individual instances are never freed. Instead, the arena can be
+ *  rewound to a previously taken mark or cleared entirely, which returns chunks to the parent at O(chunks).
+ *
+ *  Chunks form a singly linked list (newest first). A request exceeding the chunk size receives a dedicated chunk.
+ *  The default chunk size is the largest block size of the parent, so that chunks are served from its pools.
+ *  Alignment follows the rule of tbman_s_alloc (see tbman.h).
+ */
+typedef struct tbman_arena_chunk_s {
+    struct tbman_arena_chunk_s *prev; // previously allocated chunk
+    size_t size;                      // granted size of chunk (including header)
+} tbman_arena_chunk_s;
+
+typedef struct tbman_arena_s {
+    tbman_s *parent;
+    size_t chunk_size;           // default size of a chunk
+    tbman_arena_chunk_s *chunk;  // current chunk (NULL if arena is empty)
+    uint8_t *pos;                // next free byte in current chunk
+    uint8_t *end;                // end of current chunk
+} tbman_arena_s;
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t arena_align_of(size_t size) {
+    size_t align = size & (~size + 1); // largest power of two dividing size
+    return align < TBMAN_ALIGN ? align : TBMAN_ALIGN;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_arena_s *tbman_arena_s_create(tbman_s *parent, size_t chunk_size) {
+    if (!parent) {
+        ASSERT_GLOBAL_INITIALIZED();
+        parent = tbman_s_g;
+    }
+    tbman_arena_s *o = (tbman_arena_s *) tbman_s_nalloc(parent, NULL, 0, sizeof(tbman_arena_s), NULL);
+    memset(o, 0, sizeof(*o));
+    o->parent = parent;
+    if (chunk_size == 0) chunk_size = parent->size > 0 ? parent->data[parent->size - 1]->block_size : parent->pool_size;
+    o->chunk_size = chunk_size;
+    if (o->chunk_size < sizeof(tbman_arena_chunk_s) * 2) o->chunk_size = sizeof(tbman_arena_chunk_s) * 2;
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_arena_s_discard(tbman_arena_s *o) {
+    if (!o) return;
+    tbman_arena_s_clear(o);
+    tbman_s_nfree(o->parent, o, sizeof(tbman_arena_s));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void tbman_arena_s_push_chunk(tbman_arena_s *o, size_t min_size) {
+    size_t size = min_size > o->chunk_size ? min_size : o->chunk_size;
+    size_t granted_size = 0;
+    tbman_arena_chunk_s *chunk = (tbman_arena_chunk_s *) tbman_s_nalloc(o->parent, NULL, 0, size, &granted_size);
+    chunk->prev = o->chunk;
+    chunk->size = granted_size;
+    o->chunk = chunk;
+    o->pos = (uint8_t *) (chunk + 1);
+    o->end = (uint8_t *) chunk + granted_size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void tbman_arena_s_pop_chunk(tbman_arena_s *o) {
+    tbman_arena_chunk_s *chunk = o->chunk;
+    o->chunk = chunk->prev;
+    tbman_s_nfree(o->parent, chunk, chunk->size);
+    o->pos = o->chunk ? (uint8_t *) o->chunk + o->chunk->size : NULL; // a popped-to chunk is considered exhausted
+    o->end = o->pos;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void *tbman_arena_s_alloc(tbman_arena_s *o, size_t size) {
+    if (size == 0) return NULL;
+    size_t align = arena_align_of(size);
+    uint8_t *ptr = (uint8_t *) (((uintptr_t) o->pos + (align - 1)) & ~(uintptr_t) (align - 1));
+    if (!o->chunk || ptr > o->end || (size_t) (o->end - ptr) < size) {
+        if (size > SIZE_MAX - sizeof(tbman_arena_chunk_s) - align) ERR("Arena request of %zu bytes is too large.", size);
+        tbman_arena_s_push_chunk(o, sizeof(tbman_arena_chunk_s) + size + align);
+        ptr = (uint8_t *) (((uintptr_t) o->pos + (align - 1)) & ~(uintptr_t) (align - 1));
+    }
+    o->pos = ptr + size;
+    return ptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_arena_mark_s tbman_arena_s_mark(const tbman_arena_s *o) {
+    tbman_arena_mark_s mark;
+    mark.chunk = o->chunk;
+    mark.pos = o->pos;
+    return mark;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_arena_s_release(tbman_arena_s *o, tbman_arena_mark_s mark) {
+    while (o->chunk && o->chunk != mark.chunk) tbman_arena_s_pop_chunk(o);
+    if (o->chunk != mark.chunk) ERR("Invalid arena mark.");
+    if (o->chunk) {
+        o->pos = (uint8_t *) mark.pos;
+        o->end = (uint8_t *) o->chunk + o->chunk->size;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_arena_s_clear(tbman_arena_s *o) {
+    while (o->chunk) tbman_arena_s_pop_chunk(o);
+    o->pos = o->end = NULL;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_arena_s_total_space(const tbman_arena_s *o) {
+    size_t sum = 0;
+    for (const tbman_arena_chunk_s *chunk = o->chunk; chunk; chunk = chunk->prev) sum += chunk->size;
+    return sum;
+}
+
+/**********************************************************************************************************************/
+/** Slab
+ *
+ *  Binds a single block manager (size class) to an object type with optional constructor (init) and
+ *  destructor (down). Freed objects are kept in a constructed state in a cache (stack of object pointers) and
+ *  handed out again without re-initialization. Only when the cache is exhausted (alloc) or full (free), the
+ *  bound block manager is invoked directly, bypassing the size-class lookup of the parent manager.
+ *  Live objects of a slab must be freed through the slab. The slab must be discarded before its parent.
+ */
+typedef struct tbman_slab_s {
+    tbman_s *parent;
+    block_manager_s *block_manager; // size class bound to this slab
+    size_t object_size;
+    void (*init)(void *arg, void *obj);
+    void (*down)(void *arg, void *obj);
+    void *arg;                      // argument passed to init and down
+    void **cache;                   // stack of constructed free objects
+    size_t cache_size;
+    size_t cache_space;
+    std::mutex mutex;
+} tbman_slab_s;
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_slab_s *tbman_slab_s_create
+        (
+                tbman_s *parent,
+                size_t object_size,
+                size_t cache_space,
+                void (*init)(void *arg, void *obj),
+                void (*down)(void *arg, void *obj),
+                void *arg
+        ) {
+    if (!parent) {
+        ASSERT_GLOBAL_INITIALIZED();
+        parent = tbman_s_g;
+    }
+    if (object_size == 0 || object_size > parent->max_block_size)
+        ERR("object_size %zu is outside the range of managed block sizes", object_size);
+
+    tbman_slab_s *o = (tbman_slab_s *) tbman_s_nalloc(parent, NULL, 0, sizeof(tbman_slab_s), NULL);
+    new(o) tbman_slab_s{};
+
+    o->parent = parent;
+    o->object_size = object_size;
+    o->init = init;
+    o->down = down;
+    o->arg = arg;
+    size_t class_index = tbman_s_class_of(parent, object_size);
+    o->block_manager = class_index < parent->size ? parent->data[class_index] : NULL;
+
+    o->cache_space = cache_space;
+    if (o->cache_space > 0) {
+        o->cache = (void **) tbman_s_nalloc(parent, NULL, 0, sizeof(void *) * o->cache_space, NULL);
+    }
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void tbman_slab_s_release(tbman_slab_s *o, void *obj) {
+    if (o->down) o->down(o->arg, obj);
+    lock_guard<tbman_lock_s> guard(o->parent->lock);
+    token_manager_s_free(tbman_s_token_manager_of(o->parent, obj, &o->object_size), obj);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_slab_s_discard(tbman_slab_s *o) {
+    if (!o) return;
+    for (size_t i = 0; i < o->cache_size; i++) tbman_slab_s_release(o, o->cache[i]);
+    tbman_s *parent = o->parent;
+    if (o->cache) tbman_s_nfree(parent, o->cache, sizeof(void *) * o->cache_space);
+    o->~tbman_slab_s();
+    tbman_s_nfree(parent, o, sizeof(tbman_slab_s));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void *tbman_slab_s_alloc(tbman_slab_s *o) {
+    {
+        lock_guard<mutex> guard(o->mutex);
+        if (o->cache_size > 0) return o->cache[--o->cache_size];
+    }
+
+    void *obj = NULL;
+    {
+        lock_guard<tbman_lock_s> guard(o->parent->lock);
+        obj = block_manager_s_alloc(o->block_manager);
+    }
+    if (o->init) o->init(o->arg, obj);
+    return obj;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_slab_s_free(tbman_slab_s *o, void *obj) {
+    if (!obj) return;
+    {
+        lock_guard<mutex> guard(o->mutex);
+        if (o->cache_size < o->cache_space) {
+            o->cache[o->cache_size++] = obj;
+            return;
+        }
+    }
+    tbman_slab_s_release(o, obj);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_slab_s_granted_size(const tbman_slab_s *o) {
+    return o->block_manager->block_size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_slab_s_cached(tbman_slab_s *o) {
+    lock_guard<mutex> guard(o->mutex);
+    return o->cache_size;
+}
+
+/**********************************************************************************************************************/
+/** Persistent manager
+ *
+ *  A manager inside a region mapped from a file (MAP_SHARED). Closing the manager unmaps the file and leaves
+ *  its state in place; reopening maps it at the address recorded in the region and resumes.
+ *  Since the heap holds absolute addresses (metadata as well as user data), the file can only be resumed at its
+ *  original address. Reopening fails (returns NULL) if that address is not available or the state is inconsistent.
+ *
+ *  Several processes may have the file opened concurrently; each registers in the region's attach table and
+ *  closing removes only the caller's registration. Opening is serialized by a file lock (flock). It removes
+ *  registrations of terminated processes and releases locks whose holder is not a registered live process.
+ *  Processes still using the file while another one terminates inside the manager wait until they reopen it.
+ */
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+bool tbman_s_check_consistency(tbman_s *o) {
+    if (o->region && !region_s_check(o->region)) return false;
+
+    lock_guard<tbman_lock_s> guard(o->lock);
+    size_t pools = 0;
+    for (size_t i = 0; i < o->size; i++) {
+        const block_manager_s *block_manager = o->data[i];
+        if (block_manager->parent != o || block_manager->size > block_manager->space) return false;
+        if (block_manager->free_index > block_manager->size) return false;
+        if (block_manager->block_size != o->block_size_array[i]) return false;
+        for (size_t j = 0; j < block_manager->size; j++) {
+            token_manager_s *token_manager = block_manager->data[j];
+            if (token_manager->parent != block_manager || token_manager->parent_index != j) return false;
+            if (token_manager->block_size != block_manager->block_size) return false;
+            if (token_manager->pool_size != block_manager->pool_size) return false;
+            if (token_manager->stack_index > token_manager->stack_size) return false;
+            if ((j < block_manager->free_index) != token_manager_s_is_full(token_manager)) return false;
+            if (!btree_vd_s_exists(o->internal_btree, token_manager)) return false;
+        }
+        pools += block_manager->size;
+    }
+    return pools == btree_vd_s_count(o->internal_btree, NULL, NULL);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_set_root(tbman_s *o, void *root) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    o->root = root;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void *tbman_s_root(tbman_s *o) {
+    lock_guard<tbman_lock_s> guard(o->lock);
+    return o->root;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifdef TBMAN_MMAP
+
+static void *map_file_at(int fd, size_t size, void *addr) {
+    int flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+    if (addr) flags |= MAP_FIXED_NOREPLACE;
+#endif
+    void *base = mmap(addr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (base == MAP_FAILED) return NULL;
+    if (addr && base != addr) {
+        munmap(base, size);
+        return NULL;
+    }
+    return base;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/** Validates a mapped region before using its locks (no locking): a region of this build at its original address
+ *  holding a manager inside its bounds. The full consistency check follows once stale locks are released.
+ */
+static bool region_s_mapped_valid(const region_s *o) {
+    if (o->magic != REGION_MAGIC || o->layout != region_s_layout() || o->self != o) return false;
+    const uint8_t *manager = (const uint8_t *) o->manager;
+    return manager >= (const uint8_t *) (o + 1) && manager + sizeof(tbman_s) <= (const uint8_t *) o + o->size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+/// Releases the file lock of tbman_s_open_file and closes the file (a mapping keeps the file and its lock alive)
+static void unlock_file(int fd) {
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+tbman_s *tbman_s_open_file
+        (
+                const char *path,
+                size_t size,
+                size_t pool_size,
+                size_t min_block_size,
+                size_t max_block_size,
+                size_t stepping_method,
+                bool full_align
+        ) {
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) return NULL;
+
+    // serializes opening processes (creation, recovery and registration); closing needs no file lock
+    if (flock(fd, LOCK_EX) != 0) {
+        unlock_file(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        unlock_file(fd);
+        return NULL;
+    }
+
+    tbman_s *o = NULL;
+    if (st.st_size == 0) // new heap
+    {
+        if (ftruncate(fd, size) != 0) {
+            unlock_file(fd);
+            return NULL;
+        }
+        void *base = map_file_at(fd, size, NULL);
+        if (!base) {
+            unlock_file(fd);
+            return NULL;
+        }
+        o = tbman_s_create_in_region(base, size, pool_size, min_block_size, max_block_size, stepping_method, full_align);
+        region_s_register(o->region);
+    } else // existing heap: the header tells the original address
+    {
+        region_header_s head;
+        if (pread(fd, &head, sizeof(head), 0) != (ssize_t) sizeof(head) || head.magic != REGION_MAGIC ||
+            head.layout != region_s_layout() || head.size != (size_t) st.st_size) {
+            fprintf(stderr, "TBMAN WARNING: '%s' holds no compatible heap.\n", path);
+            unlock_file(fd);
+            return NULL;
+        }
+
+        void *base = map_file_at(fd, head.size, head.self);
+        if (!base) {
+            fprintf(stderr, "TBMAN WARNING: Heap '%s' cannot be mapped at its original address %p.\n", path, (void *) head.self);
+            unlock_file(fd);
+            return NULL;
+        }
+
+        region_s *region = (region_s *) base;
+        if (!region_s_mapped_valid(region)) {
+            fprintf(stderr, "TBMAN WARNING: '%s' holds no compatible heap.\n", path);
+            munmap(base, head.size);
+            unlock_file(fd);
+            return NULL;
+        }
+
+        // processes that terminated without closing leave their registration and possibly a held lock
+        region_s_prune(region);
+        region_s_recover_lock(region, &region->lock);
+        region_s_recover_lock(region, &region->manager->lock);
+
+        o = tbman_s_attach_region(base);
+        if (!tbman_s_check_consistency(o)) {
+            fprintf(stderr, "TBMAN WARNING: Heap '%s' is inconsistent.\n", path);
+            munmap(base, head.size);
+            unlock_file(fd);
+            return NULL;
+        }
+
+        if (!region_s_register(region)) {
+            fprintf(stderr, "TBMAN WARNING: Heap '%s' is opened by %i processes.\n", path, REGION_ATTACH_MAX);
+            munmap(base, head.size);
+            unlock_file(fd);
+            return NULL;
+        }
+    }
+
+    unlock_file(fd);
+    return o;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+void tbman_s_close_file(tbman_s *o) {
+    region_s *region = o->region;
+    if (!region || !region_s_unregister(region)) ERR("Manager was not opened via tbman_s_open_file by this process.");
+    size_t size = region->size;
+    msync(region, size, MS_SYNC);
+    munmap(region, size);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t tbman_s_file_processes(tbman_s *o) {
+    if (!o->region) return 0;
+    return o->region->attached.load();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#else // TBMAN_MMAP
+
+tbman_s *tbman_s_open_file(const char *path, size_t size, size_t pool_size, size_t min_block_size,
+                           size_t max_block_size, size_t stepping_method, bool full_align) {
+    ERR("Persistent managers are not supported on this platform.");
+    return NULL;
+}
+
+void tbman_s_close_file(tbman_s *o) {
+    ERR("Persistent managers are not supported on this platform.");
+}
+
+size_t tbman_s_file_processes(tbman_s *o) {
+    return 0;
+}
+
+#endif // TBMAN_MMAP
+
+/**********************************************************************************************************************/
@@ -45,9 +45,177 @@ tbman_s* tbman_s_create
             bool full_align          // true: uses full memory alignment (fastest)
          );
 
+/** Backing memory provider: Supplies all memory held by a manager (pools, large blocks, metadata).
+ *  Each function receives 'arg' as first argument.
+ *    reserve:         returns 'size' bytes aligned to at least 16; NULL when out of memory
+ *    release:         returns memory obtained via reserve or reserve_aligned ('size' as reserved)
+ *    decommit:        (optional) hint that a range of reserved memory is unused. The range remains accessible;
+ *                     its content becomes undefined (e.g. madvise MADV_DONTNEED).
+ *    reserve_aligned: (optional) like reserve but aligned to 'align' (power of two)
+ *    expand:          (optional) grows reserved memory of 'size' bytes in place (never moves it);
+ *                     returns the new size (at least min_size, preferably max_size) or 0 on failure
+ *  Without reserve_aligned, pools are not aligned (s. full_align) and large blocks are aligned as given by reserve.
+ */
+typedef struct tbman_provider_s
+{
+    void* arg;
+    void* ( *reserve  )( void* arg, size_t size );
+    void  ( *release  )( void* arg, void* ptr, size_t size );
+    void  ( *decommit )( void* arg, void* ptr, size_t size );
+    void* ( *reserve_aligned )( void* arg, size_t align, size_t size );
+    size_t ( *expand )( void* arg, void* ptr, size_t size, size_t min_size, size_t max_size );
+} tbman_provider_s;
+
+/// Provider using the system heap (aligned allocation); default provider
+const tbman_provider_s* tbman_provider_system( void );
+
+/// Provider using anonymous memory mappings (mmap, munmap, madvise); NULL on platforms without mmap
+const tbman_provider_s* tbman_provider_mmap( void );
+
+/// Concurrency control of a manager
+typedef enum tbman_lock_policy
+{
+    TBMAN_LOCK_MUTEX = 0, // mutex (default)
+    TBMAN_LOCK_SPIN,      // spin lock (used by managers inside a memory region)
+    TBMAN_LOCK_NONE,      // no locking: the manager is used by a single thread only (e.g. one manager per thread)
+    TBMAN_LOCK_ADAPTIVE,  // spins briefly, then sleeps (futex on linux); suited for short critical sections
+} tbman_lock_policy;
+
+/// Lock statistics of a manager (s. tbman_s_lock_stats)
+typedef struct tbman_lock_stats_s
+{
+    size_t acquisitions; // total acquisitions (including the query)
+    size_t contended;    // acquisitions that had to wait
+    size_t spins;        // spin iterations while waiting
+    size_t sleeps;       // times a waiting thread was put to sleep (TBMAN_LOCK_ADAPTIVE)
+    size_t hold_ns;      // total time the lock was held in ns (requires tbman_params_s::lock_timing)
+    size_t max_hold_ns;  // longest time the lock was held in ns (requires tbman_params_s::lock_timing)
+} tbman_lock_stats_s;
+
+/// Manager parameters (s. tbman_s_create); initialize via tbman_params_s_init
+typedef struct tbman_params_s
+{
+    size_t pool_size;
+    size_t min_block_size;
+    size_t max_block_size;
+    size_t stepping_method;
+    bool full_align;
+    tbman_lock_policy lock_policy;    // functions labeled thread-safe are not thread-safe with TBMAN_LOCK_NONE
+    bool lock_timing;                 // measures lock hold times (s. tbman_lock_stats_s)
+    const tbman_provider_s* provider; // backing memory (NULL: tbman_provider_system); the provider is copied
+} tbman_params_s;
+
+/// Sets default parameters
+void tbman_params_s_init( tbman_params_s* o );
+
+/// Creates a dedicated manager with specified parameters
+tbman_s* tbman_s_create_with( const tbman_params_s* params );
+
+/** Creates a dedicated manager inside a caller-provided memory region (e.g. shared memory or a mapped file).
+ *  All memory of the manager (instance, metadata, pools, large blocks) is carved from the region.
+ *  Allocations fail with an error when the region is exhausted.
+ *  The manager uses a process-shared spin lock, hence several processes mapping the region can use it concurrently.
+ *  Internal references are absolute: Each process must map the region at the same address.
+ *  The region must remain mapped until the manager is discarded (discard once, from any process).
+ */
+tbman_s* tbman_s_create_in_region
+         (
+            void* base,              // begin of region
+            size_t size,             // size of region
+            size_t pool_size,
+            size_t min_block_size,
+            size_t max_block_size,
+            size_t stepping_method,
+            bool full_align
+         );
+
+/// Returns the manager inside a region created by tbman_s_create_in_region (e.g. in another process)
+tbman_s* tbman_s_attach_region( void* base );
+
+/** Opens a persistent manager backed by a memory-mapped file (POSIX platforms).
+ *  If the file does not exist or is empty, it is created with 'size' bytes and a new manager is set up in it
+ *  (s. tbman_s_create_in_region). Otherwise the existing heap is mapped and resumed; 'size' and the
+ *  manager parameters are then ignored. The heap must be mapped at its original address because it holds
+ *  absolute addresses; it is verified via tbman_s_check_consistency.
+ *  Returns NULL if the file cannot be opened, mapped at its original address or is inconsistent.
+ *  Use tbman_s_root/tbman_s_set_root to locate data after reopening.
+ *  Several processes may have the file opened at the same time (each calls tbman_s_open_file; a forked child
+ *  does not inherit the handle). Opening releases locks and registrations left behind by processes that
+ *  terminated without closing the file.
+ */
+tbman_s* tbman_s_open_file
+         (
+            const char* path,
+            size_t size,
+            size_t pool_size,
+            size_t min_block_size,
+            size_t max_block_size,
+            size_t stepping_method,
+            bool full_align
+         );
+
+/// Unmaps a persistent manager, retaining its state in the file (the handle of the calling process becomes invalid)
+void tbman_s_close_file( tbman_s* o );
+
+/// Number of processes having the file of a persistent manager opened
+size_t tbman_s_file_processes( tbman_s* o );
+
+/// Sets/returns a root object (any address; typically the entry point of persistent data) (thread-safe)
+void  tbman_s_set_root( tbman_s* o, void* root );
+void* tbman_s_root(     tbman_s* o );
+
+/// Verifies the internal state of the manager; returns true if consistent (thread-safe)
+bool tbman_s_check_consistency( tbman_s* o );
+
 /// Discards a dedicated manager
 void tbman_s_discard( tbman_s* o );
 
+/** Invalidates all open instances of a dedicated manager at once (thread-safe).
+ *  Retains up to keep_pools memory pools per block size for reuse; all other memory is returned to the system.
+ *  Arenas and slabs drawing from this manager must be discarded before calling this function.
+ *  Cost: O(pools + external instances) rather than O(instances).
+ */
+void tbman_s_reset( tbman_s* o, size_t keep_pools );
+
+/// Returns the lock statistics accumulated since creation (thread-safe)
+tbman_lock_stats_s tbman_s_lock_stats( tbman_s* o );
+
+/** Declares the calling thread owner of a manager using TBMAN_LOCK_NONE (initially the creating thread).
+ *  Use it when handing a manager over to another thread. When compiled with RTCHECKS, calls from other
+ *  threads than the owner are reported as error.
+ */
+void tbman_s_adopt( tbman_s* o );
+
+/// Enables/disables the leak warning issued when discarding the manager (default: enabled) (thread-safe)
+void tbman_s_set_leak_warning( tbman_s* o, bool flag );
+
+/// Statistics of the maintenance thread (s. tbman_s_maintenance_start)
+typedef struct tbman_maintenance_stats_s
+{
+    size_t passes;             // completed maintenance passes
+    size_t pools_provisioned;  // empty pools created by the maintenance thread
+    size_t pools_released;     // surplus empty pools released by the maintenance thread
+    size_t pools_inline;       // pools created by allocating threads (reserve was exhausted)
+} tbman_maintenance_stats_s;
+
+/** Starts a background thread provisioning and releasing memory pools of the manager (thread-safe).
+ *  Every interval_us microseconds the thread tops up each active block size to reserve_pools ready empty pools
+ *  and releases surplus empty pools. Pools are created and returned to the provider outside the manager's lock.
+ *  While the thread runs, freeing threads never release pools inline.
+ *  Not available for managers in a region or using TBMAN_LOCK_NONE. Calling it on a running thread updates the settings.
+ *  tbman_maintenance_start applies to the global manager (s. tbman_open); one thread per process suffices.
+ */
+void tbman_maintenance_start(               size_t reserve_pools, size_t interval_us );
+void tbman_s_maintenance_start( tbman_s* o, size_t reserve_pools, size_t interval_us );
+
+/// Stops the maintenance thread (if running) and resumes inline pool release (thread-safe); called by tbman_s_discard
+void tbman_maintenance_stop( void );
+void tbman_s_maintenance_stop( tbman_s* o );
+
+/// Returns the maintenance statistics accumulated since creation (thread-safe)
+tbman_maintenance_stats_s tbman_maintenance_stats( void );
+tbman_maintenance_stats_s tbman_s_maintenance_stats( tbman_s* o );
+
 /// opens global memory manager (call this once before first usage of global tbman functions below)
 void tbman_open( void );
 
@@ -103,6 +271,61 @@ void* tbman_nalloc(               void* current_ptr, size_t current_size, size_t
 void* tbman_s_alloc(  tbman_s* o, void* current_ptr,                      size_t requested_size, size_t* granted_size );
 void* tbman_s_nalloc( tbman_s* o, void* current_ptr, size_t current_size, size_t requested_size, size_t* granted_size );
 
+/** Allocates n instances of requested_size (> 0) bytes each into ptrs[0 ... n-1] (thread-safe).
+ *  Resolves the size class once and locks the manager once. Returns the granted size of each instance.
+ *  Instances are freed individually as usual.
+ */
+size_t tbman_alloc_batch(               size_t requested_size, size_t n, void** ptrs );
+size_t tbman_s_alloc_batch( tbman_s* o, size_t requested_size, size_t n, void** ptrs );
+
+/** Frees n instances ptrs[0 ... n-1] (thread-safe). NULL entries are ignored.
+ *  sizes: NULL or sizes[i] is 0 or the previously requested or granted amount of ptrs[i] (s. tbman_nalloc).
+ *  Locks the manager once and frees instances grouped by memory pool. Pools becoming empty are swept at the end.
+ */
+void tbman_free_batch(               void* const* ptrs, const size_t* sizes, size_t n );
+void tbman_s_free_batch( tbman_s* o, void* const* ptrs, const size_t* sizes, size_t n );
+
+/** Queues an instance for freeing (lock-free; thread-safe). NULL is ignored.
+ *  The calling thread does not touch the manager's lock, pools or the system allocator; the queue is linked
+ *  through the queued instances themselves. The queue is drained in batches like tbman_s_free_batch (without
+ *  allocating scratch memory)
+ *    - by the maintenance thread on each pass (s. tbman_s_maintenance_start),
+ *    - by the thread queuing the limit-th pending instance if no maintenance thread runs (s. tbman_s_set_deferred_limit),
+ *    - by tbman_s_flush_deferred and when discarding the manager.
+ *  Queued instances count as allocated until drained. tbman_s_reset drops pending instances.
+ *  current_size: 0 or previously requested or granted amount (s. tbman_nalloc)
+ *  Requires min_block_size >= sizeof( void* ).
+ */
+void tbman_free_deferred(               void* current_ptr, size_t current_size );
+void tbman_s_free_deferred( tbman_s* o, void* current_ptr, size_t current_size );
+
+/// Frees all queued instances now; returns the number of instances freed (thread-safe)
+size_t tbman_flush_deferred( void );
+size_t tbman_s_flush_deferred( tbman_s* o );
+
+/// Sets the number of pending instances at which the queuing thread drains the queue (0: never; default) (thread-safe)
+void tbman_s_set_deferred_limit( tbman_s* o, size_t limit );
+
+/** Returns the granted size an allocation of requested_size (> 0) would receive (thread-safe).
+ *  class_index (optional) receives the size class serving the request (consecutive from 0 in order of
+ *  increasing block size) or TBMAN_CLASS_EXTERNAL for sizes exceeding the largest block size.
+ *  Allocations of equal class index are served from the same pools.
+ */
+#define TBMAN_CLASS_EXTERNAL ( ( size_t )-1 )
+size_t tbman_good_size(                      size_t requested_size, size_t* class_index );
+size_t tbman_s_good_size( const tbman_s* o, size_t requested_size, size_t* class_index );
+
+/** Grows an instance in place; never moves it (thread-safe).
+ *  Succeeds when the instance can provide at least min_size bytes at its current address, which is the case
+ *  when its granted space suffices or when the memory behind a large instance can be extended by the provider
+ *  (s. tbman_provider_s::expand). Grants preferably up to max_size.
+ *  Returns true on success and sets granted_size (optional). Returns false otherwise, leaving the instance unchanged,
+ *  so the caller can choose its own fallback (e.g. allocating a separate chunk instead of copying).
+ *  current_size: 0 or previously requested or granted amount (s. tbman_nalloc)
+ */
+bool tbman_expand(                void* current_ptr, size_t current_size, size_t min_size, size_t max_size, size_t* granted_size );
+bool tbman_s_expand(  tbman_s* o, void* current_ptr, size_t current_size, size_t min_size, size_t max_size, size_t* granted_size );
+
 /// malloc, free and realloc (thread-safe).
 static inline void* tbman_malloc(             size_t size ) { return tbman_alloc( NULL, size, NULL ); }
 static inline void* tbman_realloc( void* ptr, size_t size ) { return tbman_alloc( ptr,  size, NULL ); }
@@ -145,10 +368,34 @@ size_t tbman_s_granted_space( tbman_s* o, const void* current_ptr );
 size_t tbman_total_granted_space( void );
 size_t tbman_s_total_granted_space( tbman_s* o );
 
+/// Returns total space held by the manager: memory pools (used or not) plus large instances; excludes metadata (thread-safe)
+size_t tbman_total_space( void );
+size_t tbman_s_total_space( tbman_s* o );
+
 /// Returns number of open allocation instances (thread-safe)
 size_t tbman_total_instances( void );
 size_t tbman_s_total_instances( tbman_s* o );
 
+/// Statistics of a size class (s. tbman_s_class_stats)
+typedef struct tbman_class_stats_s
+{
+    size_t block_size;
+    size_t pools;           // memory pools currently held
+    size_t empty_pools;     // memory pools currently holding no instance
+    size_t instances;       // open instances
+    size_t pools_created;   // memory pools created since creation of the manager
+    size_t pools_discarded; // memory pools returned to the provider since creation of the manager
+    size_t churn_events;    // memory pools created shortly after empty pools were returned (raise retention)
+    double sweep_hysteresis;// current ratio of empty to used pools retained (adapts to churn)
+    size_t sweep_reserve;   // current number of empty pools retained regardless of the ratio (adapts to churn)
+} tbman_class_stats_s;
+
+/// Returns the number of size classes (thread-safe)
+size_t tbman_s_classes( tbman_s* o );
+
+/// Returns the statistics of a size class (0 <= class_index < tbman_s_classes; s. tbman_s_good_size) (thread-safe)
+tbman_class_stats_s tbman_s_class_stats( tbman_s* o, size_t class_index );
+
 /** Iterates through all open instances and calls 'callback' per instance (thread-safe)
  *  The callback function may change the manager's state.
  *  Only instances which where open at the moment of entering 'bcore_tbman_s_for_each_instance' are iterated.
@@ -161,6 +408,78 @@ void tbman_s_for_each_instance( tbman_s* o, void (*cb)( void* arg, void* ptr, si
 void print_tbman_status(               int detail_level );
 void print_tbman_s_status( tbman_s* o, int detail_level );
 
+/**********************************************************************************************************************/
+/** Arena: Bump-pointer allocation with bulk release (not thread-safe).
+ *  An arena obtains chunks from a parent manager and serves alloc requests by advancing a position pointer.
+ *  Instances are not freed individually. Instead the arena is rewound to a mark or cleared entirely,
+ *  which returns chunks to the parent at O(chunks) rather than O(instances).
+ *  Alignment follows the rule described for tbman_alloc.
+ */
+typedef struct tbman_arena_s tbman_arena_s;
+
+/// Position of an arena (obtained via tbman_arena_s_mark)
+typedef struct tbman_arena_mark_s { void* chunk; void* pos; } tbman_arena_mark_s;
+
+/** Creates an arena drawing chunks from 'parent'.
+ *  parent == NULL: uses the global manager
+ *  chunk_size == 0: uses the parent's largest block size (chunks are served from pools)
+ */
+tbman_arena_s* tbman_arena_s_create( tbman_s* parent, size_t chunk_size );
+
+/// Discards the arena and returns all chunks to the parent manager
+void tbman_arena_s_discard( tbman_arena_s* o );
+
+/// Allocates size bytes from the arena. Returns NULL for size == 0.
+void* tbman_arena_s_alloc( tbman_arena_s* o, size_t size );
+
+/// Returns the current position of the arena
+tbman_arena_mark_s tbman_arena_s_mark( const tbman_arena_s* o );
+
+/// Invalidates all instances allocated after 'mark' was taken; returns chunks obtained since then to the parent manager
+void tbman_arena_s_release( tbman_arena_s* o, tbman_arena_mark_s mark );
+
+/// Invalidates all instances and returns all chunks to the parent manager
+void tbman_arena_s_clear( tbman_arena_s* o );
+
+/// Returns total space of all chunks currently held by the arena
+size_t tbman_arena_s_total_space( const tbman_arena_s* o );
+
+/** Slab: Typed object cache bound to a single size class (thread-safe).
+ *  Objects are constructed once via 'init' and destructed via 'down' (both optional).
+ *  Freed objects are retained in a constructed state (up to cache_space objects) and returned
+ *  by subsequent alloc requests without re-initialization.
+ *  Objects of a slab must be freed via tbman_slab_s_free. Discard the slab before its parent manager.
+ */
+typedef struct tbman_slab_s tbman_slab_s;
+
+/** Creates a slab for objects of object_size bytes (object_size must not exceed the parent's max_block_size).
+ *  parent == NULL: uses the global manager
+ */
+tbman_slab_s* tbman_slab_s_create
+              (
+                  tbman_s* parent,
+                  size_t object_size,
+                  size_t cache_space,                     // maximum number of cached constructed objects
+                  void (*init)( void* arg, void* obj ),   // constructor (may be NULL)
+                  void (*down)( void* arg, void* obj ),   // destructor  (may be NULL)
+                  void* arg                               // first argument to init and down
+              );
+
+/// Discards the slab; cached objects are destructed and returned to the parent manager
+void tbman_slab_s_discard( tbman_slab_s* o );
+
+/// Returns a constructed object
+void* tbman_slab_s_alloc( tbman_slab_s* o );
+
+/// Returns the object to the slab (NULL is ignored)
+void tbman_slab_s_free( tbman_slab_s* o, void* obj );
+
+/// Returns the granted size of each object
+size_t tbman_slab_s_granted_size( const tbman_slab_s* o );
+
+/// Returns the number of currently cached objects
+size_t tbman_slab_s_cached( tbman_slab_s* o );
+
 /**********************************************************************************************************************/
 
 #ifdef __cplusplus